@@ -0,0 +1,269 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ClockTarget.h"
+
+using namespace std;
+
+// Window length in target time
+const uint64_t cDurationWindowUs = 1000000;
+// Target clock jumps back => Target restarted
+const uint64_t cThresholdRestartUs = 1000000;
+// Single outliers must not throw the estimate away
+const size_t cNumBackwardsRestart = 3;
+
+ClockTarget::ClockTarget()
+	: mWindows()
+	, mIdxWindow(0)
+	, mCntWindows(0)
+	, mTargetBaseUs(0)
+	, mTargetLastUs(0)
+	, mStartWindowUs(0)
+	, mMinCurrent()
+	, mSampleInWindow(false)
+	, mOffsetFitUs(0)
+	, mDriftFit(0)
+	, mCntSamples(0)
+	, mCntResets(0)
+	, mCntBackwards(0)
+{
+}
+
+bool ClockTarget::sampleAdd(uint64_t targetUs, uint64_t hostUs)
+{
+	double offsetUs;
+
+	if (mCntSamples && targetUs + cThresholdRestartUs < mTargetLastUs)
+	{
+		++mCntBackwards;
+
+		if (mCntBackwards < cNumBackwardsRestart)
+			return false;
+
+		reset();
+		++mCntResets;
+	}
+
+	mCntBackwards = 0;
+
+	if (!mCntSamples)
+	{
+		mTargetBaseUs = targetUs;
+		mStartWindowUs = targetUs;
+	}
+
+	++mCntSamples;
+	mTargetLastUs = targetUs;
+
+	if (targetUs - mStartWindowUs >= cDurationWindowUs && mSampleInWindow)
+	{
+		mWindows[mIdxWindow] = mMinCurrent;
+		mIdxWindow = (mIdxWindow + 1) % cNumWindows;
+		if (mCntWindows < cNumWindows)
+			++mCntWindows;
+
+		mStartWindowUs = targetUs;
+		mSampleInWindow = false;
+
+		fitUpdate();
+	}
+
+	offsetUs = (double)(int64_t)(hostUs - targetUs);
+
+	if (mSampleInWindow && offsetUs >= mMinCurrent.offsetUs)
+		return true;
+
+	mMinCurrent.targetUs = (double)(targetUs - mTargetBaseUs);
+	mMinCurrent.offsetUs = offsetUs;
+	mSampleInWindow = true;
+
+	// Bootstrap with the best sample so far
+	if (!mCntWindows)
+		mOffsetFitUs = offsetUs;
+
+	return true;
+}
+
+void ClockTarget::reset()
+{
+	mIdxWindow = 0;
+	mCntWindows = 0;
+	mTargetBaseUs = 0;
+	mTargetLastUs = 0;
+	mStartWindowUs = 0;
+	mSampleInWindow = false;
+	mOffsetFitUs = 0;
+	mDriftFit = 0;
+	mCntSamples = 0;
+	mCntBackwards = 0;
+}
+
+int64_t ClockTarget::hostUsGet(uint64_t targetUs) const
+{
+	double x = (double)(int64_t)(targetUs - mTargetBaseUs);
+
+	return (int64_t)targetUs + (int64_t)(mOffsetFitUs + mDriftFit * x);
+}
+
+/*
+ * x is taken relative to the oldest window. Otherwise
+ * the sums of squares cancel out after some time.
+ *
+ * The fitted line runs through the middle of the minima.
+ * It is shifted down onto the lowest one => No window
+ * lies below it and latencies stay positive.
+ *
+ * Literature
+ * - https://en.wikipedia.org/wiki/Simple_linear_regression
+ * - https://www.rfc-editor.org/rfc/rfc5905 (clock filter)
+ */
+void ClockTarget::fitUpdate()
+{
+	double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+	double n = (double)mCntWindows;
+	double xRef, x, denom, offsetUs, residual, residualMin;
+	size_t idxOldest = mCntWindows < cNumWindows ? 0 : mIdxWindow;
+
+	xRef = mWindows[idxOldest].targetUs;
+
+	for (size_t i = 0; i < mCntWindows; ++i)
+	{
+		const MinWindow &w = mWindows[i];
+
+		x = w.targetUs - xRef;
+
+		sumX += x;
+		sumY += w.offsetUs;
+		sumXX += x * x;
+		sumXY += x * w.offsetUs;
+	}
+
+	denom = n * sumXX - sumX * sumX;
+
+	if (mCntWindows < 2 || denom <= 0)
+	{
+		mDriftFit = 0;
+		offsetUs = sumY / n;
+	}
+	else
+	{
+		mDriftFit = (n * sumXY - sumX * sumY) / denom;
+		offsetUs = (sumY - mDriftFit * sumX) / n;
+	}
+
+	residualMin = 0;
+
+	for (size_t i = 0; i < mCntWindows; ++i)
+	{
+		const MinWindow &w = mWindows[i];
+
+		x = w.targetUs - xRef;
+		residual = w.offsetUs - (offsetUs + mDriftFit * x);
+
+		if (!i || residual < residualMin)
+			residualMin = residual;
+	}
+
+	offsetUs += residualMin;
+
+	// hostUsGet() counts x from mTargetBaseUs
+	mOffsetFitUs = offsetUs - mDriftFit * xRef;
+}
+
+bool logTickParse(const string &line, uint64_t &targetUs)
+{
+	const char *pCh = line.c_str();
+	uint64_t val = 0, frac = 0, scale = 1000000;
+	size_t cntDigits = 0;
+	bool bracketed = false;
+
+	while (1)
+	{
+		if (*pCh == ' ' || *pCh == '\t')
+		{
+			++pCh;
+			continue;
+		}
+
+		if (*pCh != 0x1B)
+			break;
+
+		// CSI sequence: ESC [ params final
+		++pCh;
+		if (*pCh == '[')
+			++pCh;
+
+		while (*pCh && (*pCh < 0x40 || *pCh > 0x7E))
+			++pCh;
+
+		if (!*pCh)
+			return false;
+
+		++pCh;
+	}
+
+	if (*pCh == '[')
+	{
+		bracketed = true;
+		++pCh;
+	}
+
+	for (; *pCh >= '0' && *pCh <= '9' && cntDigits < 15; ++pCh, ++cntDigits)
+		val = val * 10 + (uint64_t)(*pCh - '0');
+
+	if (!cntDigits)
+		return false;
+
+	if (bracketed)
+	{
+		if (*pCh != ']')
+			return false;
+
+		targetUs = val * 1000;
+		return true;
+	}
+
+	if (*pCh != '.')
+		return false;
+
+	++pCh;
+
+	for (; *pCh >= '0' && *pCh <= '9'; ++pCh)
+	{
+		if (scale == 1)
+			continue;
+
+		scale /= 10;
+		frac += (uint64_t)(*pCh - '0') * scale;
+	}
+
+	if (*pCh && *pCh != ' ' && *pCh != '\t')
+		return false;
+
+	targetUs = val * 1000000 + frac;
+
+	return true;
+}
+
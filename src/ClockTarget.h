@@ -0,0 +1,108 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CLOCK_TARGET_H
+#define CLOCK_TARGET_H
+
+#include <cinttypes>
+#include <string>
+
+/*
+ * Relation between the clock of the target and the
+ * monotonic clock of the host.
+ *
+ * Each sample pairs a target timestamp found in a log
+ * line with the host time its first byte was read.
+ * Their difference is the clock offset plus a varying
+ * transport delay. Only the minimum of each window is
+ * kept => The delay is filtered out. A least squares
+ * fit over these minima yields the drift. The line is
+ * then lowered onto the smallest minimum.
+ *
+ * Target latencies are given relative to the fastest
+ * observed path. The constant part is not visible.
+ */
+class ClockTarget
+{
+
+public:
+
+	ClockTarget();
+
+	// False for outliers. They are ignored
+	bool sampleAdd(uint64_t targetUs, uint64_t hostUs);
+	void reset();
+
+	bool valid() const { return mCntWindows || mSampleInWindow; }
+	// Host time of the target timestamp
+	int64_t hostUsGet(uint64_t targetUs) const;
+	int64_t offsetUs() const { return (int64_t)mOffsetFitUs; }
+	double driftPpm() const { return mDriftFit * 1e6; }
+	size_t cntSamples() const { return mCntSamples; }
+	size_t cntResets() const { return mCntResets; }
+
+private:
+
+	struct MinWindow
+	{
+		double targetUs;
+		double offsetUs;
+	};
+
+	ClockTarget(const ClockTarget &) = delete;
+	ClockTarget &operator=(const ClockTarget &) = delete;
+
+	void fitUpdate();
+
+	static const size_t cNumWindows = 32;
+
+	MinWindow mWindows[cNumWindows];
+	size_t mIdxWindow;
+	size_t mCntWindows;
+	uint64_t mTargetBaseUs;
+	uint64_t mTargetLastUs;
+	uint64_t mStartWindowUs;
+	MinWindow mMinCurrent;
+	bool mSampleInWindow;
+	double mOffsetFitUs;
+	double mDriftFit;
+	size_t mCntSamples;
+	size_t mCntResets;
+	size_t mCntBackwards;
+
+};
+
+/*
+ * Leading timestamp of a target log line. Color codes
+ * and spaces in front are skipped.
+ * - Seconds with fraction '12.345' => [s]
+ * - Bracketed tick counter '[12345]' => [ms]
+ * Bare integers are ignored. Too easy to confuse
+ * with the text of the message: '3 retries left'
+ */
+bool logTickParse(const std::string &line, uint64_t &targetUs);
+
+#endif
+
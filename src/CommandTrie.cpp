@@ -0,0 +1,224 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+
+#include "CommandTrie.h"
+
+using namespace std;
+
+static bool entryIdLess(const EntryHelp &a, const EntryHelp &b);
+
+CommandTrie::CommandTrie()
+	: mEntries()
+	, mNodes()
+	, mGen(0)
+{
+	build(list<EntryHelp>());
+}
+
+void CommandTrie::build(const list<EntryHelp> &entries)
+{
+	NodeTrie nodeRoot;
+
+	mEntries.assign(entries.begin(), entries.end());
+
+	// Sorted => Candidates are listed alphabetically
+	sort(mEntries.begin(), mEntries.end(), entryIdLess);
+
+	nodeRoot.idxEntry = cNodeTrieNone;
+	nodeRoot.idxEntryAny = cNodeTrieNone;
+	nodeRoot.cntEntries = 0;
+	nodeRoot.depth = 0;
+	nodeRoot.depthCompletion = 0;
+
+	mNodes.clear();
+	mNodes.push_back(nodeRoot);
+
+	for (uint32_t i = 0; i < mEntries.size(); ++i)
+		entryInsert(i);
+
+	completionsSet(root());
+
+	++mGen;
+}
+
+uint32_t CommandTrie::childGet(uint32_t node, char ch) const
+{
+	if (node >= mNodes.size())
+		return cNodeTrieNone;
+
+	const vector<pair<char, uint32_t> > &children = mNodes[node].children;
+
+	// Bounded by the character set
+	for (size_t i = 0; i < children.size(); ++i)
+	{
+		if (children[i].first == ch)
+			return children[i].second;
+	}
+
+	return cNodeTrieNone;
+}
+
+string CommandTrie::completionGet(uint32_t node) const
+{
+	if (node >= mNodes.size())
+		return "";
+
+	const NodeTrie &n = mNodes[node];
+
+	if (n.idxEntryAny == cNodeTrieNone)
+		return "";
+
+	return mEntries[n.idxEntryAny].id.substr(n.depth, n.depthCompletion - n.depth);
+}
+
+size_t CommandTrie::cntCandidates(uint32_t node) const
+{
+	if (node >= mNodes.size())
+		return 0;
+
+	return mNodes[node].cntEntries;
+}
+
+void CommandTrie::candidatesGet(uint32_t node,
+				vector<const EntryHelp *> &candidates,
+				size_t cntMax) const
+{
+	candidates.clear();
+
+	if (node >= mNodes.size())
+		return;
+
+	const NodeTrie &n = mNodes[node];
+
+	if (n.idxEntryAny == cNodeTrieNone)
+		return;
+
+	// Entries are sorted => All candidates are adjacent
+	for (uint32_t i = n.idxEntryAny; i < mEntries.size(); ++i)
+	{
+		if (candidates.size() >= cntMax || candidates.size() >= n.cntEntries)
+			break;
+
+		candidates.push_back(&mEntries[i]);
+	}
+}
+
+const EntryHelp *CommandTrie::entryGet(uint32_t node) const
+{
+	if (node >= mNodes.size())
+		return NULL;
+
+	uint32_t idxEntry = mNodes[node].idxEntry;
+
+	if (idxEntry == cNodeTrieNone)
+		return NULL;
+
+	return &mEntries[idxEntry];
+}
+
+void CommandTrie::entryInsert(uint32_t idxEntry)
+{
+	const string &id = mEntries[idxEntry].id;
+	uint32_t node = root(), child;
+	NodeTrie nodeNew;
+
+	if (!id.size())
+		return;
+
+	nodeNew.idxEntry = cNodeTrieNone;
+	nodeNew.cntEntries = 0;
+	nodeNew.depthCompletion = 0;
+
+	for (size_t i = 0; i <= id.size(); ++i)
+	{
+		NodeTrie &n = mNodes[node];
+
+		++n.cntEntries;
+
+		// First entry below is the smallest one
+		if (n.idxEntryAny == cNodeTrieNone)
+			n.idxEntryAny = idxEntry;
+
+		if (i == id.size())
+		{
+			// Duplicates: First one wins
+			if (n.idxEntry == cNodeTrieNone)
+				n.idxEntry = idxEntry;
+			break;
+		}
+
+		child = childGet(node, id[i]);
+		if (child != cNodeTrieNone)
+		{
+			node = child;
+			continue;
+		}
+
+		child = mNodes.size();
+
+		nodeNew.idxEntryAny = idxEntry;
+		nodeNew.depth = i + 1;
+
+		mNodes[node].children.push_back(make_pair(id[i], child));
+		mNodes.push_back(nodeNew);
+
+		node = child;
+	}
+}
+
+/*
+ * Follow the chain of nodes having exactly one child
+ * and no entry of their own. Calculated once for all
+ * nodes, bottom up
+ */
+void CommandTrie::completionsSet(uint32_t node)
+{
+	NodeTrie &n = mNodes[node];
+
+	for (size_t i = 0; i < n.children.size(); ++i)
+		completionsSet(n.children[i].second);
+
+	NodeTrie &nCur = mNodes[node];
+
+	nCur.depthCompletion = nCur.depth;
+
+	if (nCur.idxEntry != cNodeTrieNone)
+		return;
+
+	if (nCur.children.size() != 1)
+		return;
+
+	nCur.depthCompletion = mNodes[nCur.children[0].second].depthCompletion;
+}
+
+/* static functions */
+
+bool entryIdLess(const EntryHelp &a, const EntryHelp &b)
+{
+	return a.id < b.id;
+}
+
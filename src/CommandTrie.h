@@ -0,0 +1,109 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COMMAND_TRIE_H
+#define COMMAND_TRIE_H
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+#include <list>
+
+struct EntryHelp
+{
+	std::string id;
+	std::string shortcut;
+	std::string desc;
+	std::string group;
+};
+
+/*
+ * Prefix trie over the command IDs of a target.
+ *
+ * Sessions walk the trie one character per keystroke.
+ * Every node knows how far the input can be completed
+ * unambiguously and how many commands lie below it.
+ * Therefore each keystroke and each completion costs
+ * constant time, independent of the number of commands.
+ *
+ * Nodes are referenced by index. After build() all
+ * indices held by sessions are invalid => Check gen()
+ */
+const uint32_t cNodeTrieNone = 0xFFFFFFFF;
+
+class CommandTrie
+{
+
+public:
+
+	CommandTrie();
+
+	void build(const std::list<EntryHelp> &entries);
+
+	uint32_t gen() const { return mGen; }
+	size_t size() const { return mEntries.size(); }
+
+	uint32_t root() const { return 0; }
+	uint32_t childGet(uint32_t node, char ch) const;
+
+	// Characters which can be appended unambiguously
+	std::string completionGet(uint32_t node) const;
+
+	size_t cntCandidates(uint32_t node) const;
+	void candidatesGet(uint32_t node,
+				std::vector<const EntryHelp *> &candidates,
+				size_t cntMax) const;
+
+	// Exact match. NULL otherwise
+	const EntryHelp *entryGet(uint32_t node) const;
+
+	const std::vector<EntryHelp> &entries() const { return mEntries; }
+
+private:
+
+	struct NodeTrie
+	{
+		std::vector<std::pair<char, uint32_t> > children;
+		uint32_t idxEntry;
+		uint32_t idxEntryAny;
+		uint32_t cntEntries;
+		uint16_t depth;
+		uint16_t depthCompletion;
+	};
+
+	CommandTrie(const CommandTrie &) = delete;
+	CommandTrie &operator=(const CommandTrie &) = delete;
+
+	void entryInsert(uint32_t idxEntry);
+	void completionsSet(uint32_t node);
+
+	std::vector<EntryHelp> mEntries;
+	std::vector<NodeTrie> mNodes;
+	uint32_t mGen;
+
+};
+
+#endif
+
@@ -24,6 +24,9 @@
 */
 
 #include "GwMsgDispatching.h"
+#include "LibWakeup.h"
+#include "LibCatalog.h"
+#include "LibTime.h"
 #if 0
 #include "ColorTesting.h"
 #include "ThreadPooling.h"
@@ -53,27 +56,49 @@ using namespace std;
 
 #define dCursorHide "\033[?25l"
 #define dCursorShow "\033[?25h"
-#define dScreenClear "\033[2J\033[H"
 
 typedef list<struct RemoteDebuggingPeer>::iterator PeerIter;
 
 const string cSeqCtrlC = "\xff\xf4\xff\xfd\x06";
 const size_t cLenSeqCtrlC = cSeqCtrlC.size();
 
-GwMsgDispatching::GwMsgDispatching()
+GwMsgDispatching::GwMsgDispatching(const string &deviceUart, uint16_t portStart)
 	: Processing("GwMsgDispatching")
 	//, mStartMs(0)
-	, mPortStart(3000)
+	, mDeviceUart(deviceUart)
+	, mPortStart(portStart)
 	, mListenLocal(false)
 	, mpLstProc(NULL)
 	, mpLstLog(NULL)
 	, mpLstCmd(NULL)
+	, mpLstTap(NULL)
 	, mpCtrl(NULL)
 	, mpGather(NULL)
 	, mCursorHidden(false)
 	, mDevUartIsOnline(true)
 	, mTargetIsOnline(false)
 	, mListPeers()
+	, mIdPeerNext(1)
+	, mTrieCmds()
+	, mKeyCatalog()
+	, mEntriesCatalog()
+	, mpContentProc(std::make_shared<const string>(dContentProcPrefix))
+	, mContentHist("")
+	, mChunkTap("")
+	, mEntryLog()
+	, mEntryLogTimed("")
+	, mTreeProc()
+	, mHistProc()
+	, mClockTarget()
+	, mHistLogWire()
+	, mHistLogGateway()
+	, mHistLogTarget()
+#if CONFIG_APP_HAVE_PROFILING
+	, mProfTick()
+#endif
+#if CONFIG_APP_HAVE_ALLOC_TRACKING
+	, mAllocTick()
+#endif
 {
 	mState = StStart;
 }
@@ -82,6 +107,8 @@ GwMsgDispatching::GwMsgDispatching()
 
 Success GwMsgDispatching::process()
 {
+	dProfileTick(mProfTick);
+	dAllocTick(mAllocTick);
 	//uint32_t curTimeMs = millis();
 	//uint32_t diffMs = curTimeMs - mStartMs;
 	Success success;
@@ -93,32 +120,30 @@ Success GwMsgDispatching::process()
 	{
 	case StStart:
 
-		mPortStart = env.startPortsTarget;
-
 		ok = servicesStart();
 		if (!ok)
 			return procErrLog(-1, "could not start services");
 
-		mpCtrl = SingleWireScheduling::create();
+		mpCtrl = SingleWireScheduling::create(mDeviceUart);
 		if (!mpCtrl)
 			return procErrLog(-1, "could not create process");
 
 		//mpCtrl->procTreeDisplaySet(false);
-#if 1
-		start(mpCtrl);
-#else
+#if CONFIG_PROC_HAVE_DRIVERS
+		// UART timing must not depend on the number of peers
 		start(mpCtrl, DrivenByNewInternalDriver);
+#else
+		start(mpCtrl);
 #endif
-		fprintf(stdout, "CodeOrb-25.04-1\n");
-		fprintf(stdout, "Using device: %s\n", env.deviceUart.c_str());
+		fprintf(stdout, "Using device: %s\n", mDeviceUart.c_str());
 
 		fprintf(stdout, "Listening on: %u, %u, %u\n",
 								mPortStart,
 								(uint16_t)(mPortStart + 2),
 								(uint16_t)(mPortStart + 4));
 
-		if (env.ctrlManual)
-			fprintf(stdout, "Manual control enabled\n");
+		if (mpLstTap)
+			fprintf(stdout, "UART tap on: %u\n", (uint16_t)(mPortStart + 6));
 
 #ifndef _WIN32
 		if (!env.verbosity)
@@ -158,7 +183,10 @@ Success GwMsgDispatching::process()
 			break;
 		}
 
-		mpGather = InfoGathering::create();
+		// Gathering continues in the background to revalidate
+		catalogRestore();
+
+		mpGather = InfoGathering::create(mpCtrl);
 		if (!mpGather)
 		{
 			procWrnLog("could not create process");
@@ -195,7 +223,7 @@ Success GwMsgDispatching::process()
 			procWrnLog("could not gather information");
 #endif
 		if (success == Positive)
-			RemoteCommanding::listCommandsUpdate(mpGather->mEntriesReceived);
+			catalogStore(mpGather->mEntriesReceived);
 
 		repel(mpGather);
 		mpGather = NULL;
@@ -237,12 +265,23 @@ void GwMsgDispatching::stateOnlineCheckAndPrint()
 	if (env.verbosity)
 		return;
 
-	fprintf(stdout, "\rUART [ ");
+	// Status line can only be overwritten with a single target
+	bool targetsMultiple = env.devicesUart.size() > 1;
+
+	if (targetsMultiple)
+		fprintf(stdout, "%s: ", mDeviceUart.c_str());
+	else
+		fprintf(stdout, "\r");
+
+	fprintf(stdout, "UART [ ");
 	onlinePrint(mDevUartIsOnline);
 	fprintf(stdout, " ] - Target [ ");
 	onlinePrint(mTargetIsOnline);
 	fprintf(stdout, " ]  ");
 
+	if (targetsMultiple)
+		fprintf(stdout, "\n");
+
 	fflush(stdout);
 }
 
@@ -273,6 +312,14 @@ void GwMsgDispatching::onlinePrint(bool online)
 
 bool GwMsgDispatching::servicesStart()
 {
+	if (env.dirHistory.size())
+	{
+		string path = env.dirHistory + "/prochist-" + to_string(mPortStart) + ".bin";
+
+		if (!mHistProc.spillSet(path))
+			procWrnLog("could not open history file %s", path.c_str());
+	}
+
 	// proc tree
 	mpLstProc = TcpListening::create();
 	if (!mpLstProc)
@@ -303,6 +350,20 @@ bool GwMsgDispatching::servicesStart()
 
 	mpLstCmd->procTreeDisplaySet(false);
 	start(mpLstCmd);
+
+	if (env.uartTap)
+	{
+		// uart tap
+		mpLstTap = TcpListening::create();
+		if (!mpLstTap)
+			return procErrLog(-1, "could not create process");
+
+		mpLstTap->portSet(mPortStart + 6, mListenLocal);
+		mpLstTap->maxConnSet(4);
+
+		mpLstTap->procTreeDisplaySet(false);
+		start(mpLstTap);
+	}
 #if 0
 	ThreadPooling *pPool;
 
@@ -324,34 +385,90 @@ void GwMsgDispatching::peerListUpdate()
 	peerAdd(mpLstLog, RemotePeerLog, "log");
 #endif
 	peerAdd(mpLstCmd, RemotePeerCmd, "command");
+
+	if (mpLstTap)
+	{
+		peerAdd(mpLstTap, RemotePeerTap, "uart tap");
+		tapUpdate();
+	}
 }
 
 void GwMsgDispatching::contentDistribute()
 {
 	// proc tree
-	if (mpCtrl->contentProcChanged())
+	if (mpCtrl->contentProcGet(mpContentProc))
 	{
-		string str(dScreenClear);
-		str += mpCtrl->mContentProc;
-		contentSend(str, RemotePeerProc);
+		mTreeProc.update(*mpContentProc);
+		mHistProc.add(*mpContentProc, millis());
+
+		// Screen clear is already in front => One write per frame
+		contentSend(*mpContentProc, RemotePeerProc);
 	}
 
 	// log
-	PipeEntry<string> entryLog;
+	while (mpCtrl->rgEntriesLog.get(mEntryLog))
+		entryLogSend(mEntryLog);
 
-	while (1)
+	// uart tap
+	while (mpCtrl->rgTap.get(mChunkTap))
+		contentSend(mChunkTap, RemotePeerTap);
+}
+
+/*
+ * Stages of a log entry
+ * - Target: Tick counter in the line => Host read of first byte
+ *           Relative to the fastest path seen. Needs a tick counter
+ * - Wire:   First byte => Last byte of the frame
+ * - Gateway: Last byte => Handed to the peers
+ */
+void GwMsgDispatching::entryLogSend(const EntryLog &entry)
+{
+	uint64_t curUs = usMonotonic();
+	uint64_t usWire = entry.lastUs - entry.firstUs;
+	uint64_t usGateway = curUs - entry.lastUs;
+	uint64_t targetUs = 0;
+	int64_t usTarget = -1;
+	char bufPrefix[96];
+
+	mHistLogWire.add(usWire);
+	mHistLogGateway.add(usGateway);
+
+	if (logTickParse(entry.str, targetUs) &&
+			mClockTarget.sampleAdd(targetUs, entry.firstUs))
 	{
-		if (mpCtrl->ppEntriesLog.get(entryLog) < 1)
-			break;
+		usTarget = (int64_t)entry.firstUs - mClockTarget.hostUsGet(targetUs);
+		if (usTarget < 0)
+			usTarget = 0;
 
-		contentSend(entryLog.particle, RemotePeerLog);
+		mHistLogTarget.add((uint64_t)usTarget);
 	}
+
+	if (!env.logTiming)
+	{
+		contentSend(entry.str, RemotePeerLog);
+		return;
+	}
+
+	if (usTarget < 0)
+		snprintf(bufPrefix, sizeof(bufPrefix),
+				"[%" PRIu64 ".%06" PRIu64 " wire %" PRIu64 " gw %" PRIu64 "] ",
+				entry.firstUs / 1000000, entry.firstUs % 1000000,
+				usWire, usGateway);
+	else
+		snprintf(bufPrefix, sizeof(bufPrefix),
+				"[%" PRIu64 ".%06" PRIu64 " tgt %" PRId64 " wire %" PRIu64 " gw %" PRIu64 "] ",
+				entry.firstUs / 1000000, entry.firstUs % 1000000,
+				usTarget, usWire, usGateway);
+
+	mEntryLogTimed = bufPrefix;
+	mEntryLogTimed += entry.str;
+
+	contentSend(mEntryLogTimed, RemotePeerLog);
 }
 
 void GwMsgDispatching::contentSend(const string &str, RemotePeerType typePeer)
 {
 	PeerIter iter;
-	TcpTransfering *pTrans;
 
 	iter = mListPeers.begin();
 	for (; iter != mListPeers.end(); ++iter)
@@ -359,13 +476,24 @@ void GwMsgDispatching::contentSend(const string &str, RemotePeerType typePeer)
 		if (iter->type != typePeer)
 			continue;
 
-		pTrans = (TcpTransfering *)iter->pProc;
+		// Viewer is scrubbing through the history
+		if (iter->idFrameHist)
+			continue;
 
-		pTrans->send(str.data(), str.size());
+		peerSend(*iter, str);
 	}
 }
 
-bool GwMsgDispatching::disconnectRequestedCheck(TcpTransfering *pTrans)
+// Content is built once per frame and sent as is. No copy per peer
+void GwMsgDispatching::peerSend(struct RemoteDebuggingPeer &peer, const string &str)
+{
+	TcpTransfering *pTrans = (TcpTransfering *)peer.pProc;
+
+	pTrans->send(str.data(), str.size());
+	peer.bytesSent += str.size();
+}
+
+bool GwMsgDispatching::disconnectRequestedCheck(TcpTransfering *pTrans, string *pInput)
 {
 	if (!pTrans)
 		return false;
@@ -400,15 +528,93 @@ bool GwMsgDispatching::disconnectRequestedCheck(TcpTransfering *pTrans)
 		return true;
 	}
 
+	if (pInput)
+		pInput->assign(buf, lenDone);
+
 	return false;
 }
 
+/*
+ * Keys of process tree viewers
+ * - ',' or Left    One frame back
+ * - '.' or Right   One frame forward
+ * - '<' or Up      Ten frames back
+ * - '>' or Down    Ten frames forward
+ * - 'l'            Back to live view
+ */
+void GwMsgDispatching::historyScrub(struct RemoteDebuggingPeer &peer, const string &input)
+{
+	int64_t step = 0, id;
+	bool live = false;
+	uint32_t timeMs;
+	char buf[96];
+	char ch;
+
+	for (size_t i = 0; i < input.size(); ++i)
+	{
+		ch = input[i];
+
+		if (ch == '\033' && i + 2 < input.size() && input[i + 1] == '[')
+		{
+			ch = input[i + 2];
+			i += 2;
+
+			if (ch == 'D') ch = ',';
+			else if (ch == 'C') ch = '.';
+			else if (ch == 'A') ch = '<';
+			else if (ch == 'B') ch = '>';
+		}
+
+		if (ch == ',') --step;
+		else if (ch == '.') ++step;
+		else if (ch == '<') step -= 10;
+		else if (ch == '>') step += 10;
+		else if (ch == 'l') live = true;
+	}
+
+	if (!live && !step)
+		return;
+
+	id = peer.idFrameHist ? peer.idFrameHist : mHistProc.idLast();
+	id += step;
+
+	if (live || !mHistProc.size() || id > mHistProc.idLast())
+	{
+		peer.idFrameHist = 0;
+		peerSend(peer, *mpContentProc);
+
+		return;
+	}
+
+	if (id < mHistProc.idFirst())
+		id = mHistProc.idFirst();
+
+	peer.idFrameHist = id;
+
+	if (!mHistProc.frameGet(peer.idFrameHist, mContentHist, timeMs))
+		return;
+
+	snprintf(buf, sizeof(buf),
+			"[History %u/%u, %.1fs ago. ',' '.' step, '<' '>' 10 steps, 'l' live]\r\n",
+			peer.idFrameHist, mHistProc.idLast(),
+			(millis() - timeMs) / 1000.0);
+
+	// Frames are stored with the screen clear in front
+	if (!mContentHist.compare(0, cLenContentProcPrefix, dContentProcPrefix))
+		mContentHist.insert(cLenContentProcPrefix, buf);
+	else
+		mContentHist.insert(0, string(dContentProcPrefix) + buf);
+
+	peerSend(peer, mContentHist);
+}
+
 void GwMsgDispatching::peerCheck()
 {
 	PeerIter iter;
 	struct RemoteDebuggingPeer peer;
 	Processing *pProc;
 	bool disconnectReq, removeReq;
+	string input;
 
 	iter = mListPeers.begin();
 	while (iter != mListPeers.end())
@@ -417,9 +623,15 @@ void GwMsgDispatching::peerCheck()
 		pProc = peer.pProc;
 
 		if (peer.type == RemotePeerProc)
-			disconnectReq = disconnectRequestedCheck((TcpTransfering *)pProc);
+		{
+			input.clear();
+			disconnectReq = disconnectRequestedCheck((TcpTransfering *)pProc, &input);
+
+			if (!disconnectReq && input.size())
+				historyScrub(*iter, input);
+		}
 		else
-		if (peer.type == RemotePeerLog)
+		if (peer.type == RemotePeerLog || peer.type == RemotePeerTap)
 		{
 			TcpTransfering *pTrans = (TcpTransfering *)pProc;
 			disconnectReq = disconnectRequestedCheck(pTrans);
@@ -435,12 +647,32 @@ void GwMsgDispatching::peerCheck()
 		}
 
 		procDbgLog("removing %s peer. process: %p", peer.typeDesc.c_str(), pProc);
+		wakeupFdRemove(peer.fd);
 		repel(pProc);
 
 		iter = mListPeers.erase(iter);
 	}
 }
 
+// Scheduler only copies bytes while someone listens
+void GwMsgDispatching::tapUpdate()
+{
+	PeerIter iter;
+	bool active = false;
+
+	iter = mListPeers.begin();
+	for (; iter != mListPeers.end(); ++iter)
+	{
+		if (iter->type != RemotePeerTap)
+			continue;
+
+		active = true;
+		break;
+	}
+
+	mpCtrl->tapActiveSet(active);
+}
+
 void GwMsgDispatching::peerAdd(TcpListening *pListener, enum RemotePeerType peerType, const char *pTypeDesc)
 {
 	PipeEntry<SOCKET> peerFd;
@@ -456,14 +688,27 @@ void GwMsgDispatching::peerAdd(TcpListening *pListener, enum RemotePeerType peer
 		{
 			RemoteCommanding *pCmd;
 
-			pCmd = RemoteCommanding::create(peerFd.particle);
+			pCmd = RemoteCommanding::create(peerFd.particle, mpCtrl, &mTrieCmds);
 			if (!pCmd)
 			{
 				procErrLog(-1, "could not create process");
 				continue;
 			}
 
-			whenFinishedRepel(start(pCmd));
+			start(pCmd);
+
+			procDbgLog("adding %s peer. process: %p", pTypeDesc, pCmd);
+
+			// Session registers its socket for wakeups by itself
+			peer.type = peerType;
+			peer.typeDesc = pTypeDesc;
+			peer.pProc = pCmd;
+			peer.fd = INVALID_SOCKET;
+			peer.id = mIdPeerNext++;
+			peer.bytesSent = 0;
+			peer.idFrameHist = 0;
+
+			mListPeers.push_back(peer);
 
 			continue;
 		}
@@ -478,30 +723,133 @@ void GwMsgDispatching::peerAdd(TcpListening *pListener, enum RemotePeerType peer
 		pTrans->procTreeDisplaySet(false);
 		start(pTrans);
 
-		if (peerType == RemotePeerProc)
-		{
-			string str(dScreenClear);
-			str += mpCtrl->mContentProc;
-			pTrans->send(str.data(), str.size());
-		}
-
 		procDbgLog("adding %s peer. process: %p", pTypeDesc, pTrans);
 
 		peer.type = peerType;
 		peer.typeDesc = pTypeDesc;
 		peer.pProc = pTrans;
+		peer.fd = peerFd.particle;
+		peer.id = mIdPeerNext++;
+		peer.bytesSent = 0;
+		peer.idFrameHist = 0;
+
+		if (peerType == RemotePeerProc)
+			peerSend(peer, *mpContentProc);
 
+		wakeupFdAdd(peer.fd);
 		mListPeers.push_back(peer);
 	}
 }
 
+/*
+ * Only targets reporting their firmware identity get a
+ * stored catalog. The device alone says nothing about
+ * the firmware behind it. Such catalogs are offered
+ * once InfoGathering has fetched them
+ */
+void GwMsgDispatching::catalogRestore()
+{
+	string idFirmware = mpCtrl->firmwareIdGet();
+
+	mKeyCatalog.clear();
+
+	if (idFirmware.size())
+		mKeyCatalog = "fw:" + idFirmware;
+
+	if (!mKeyCatalog.size() || !catalogLoad(mKeyCatalog, mEntriesCatalog))
+	{
+		// Commands of the previous firmware must not be offered
+		mEntriesCatalog.clear();
+		RemoteCommanding::listCommandsUpdate(mEntriesCatalog, mTrieCmds);
+
+		return;
+	}
+
+	procDbgLog("using stored command catalog: %s", mKeyCatalog.c_str());
+
+	RemoteCommanding::listCommandsUpdate(mEntriesCatalog, mTrieCmds);
+}
+
+void GwMsgDispatching::catalogStore(const list<string> &entries)
+{
+	if (entries == mEntriesCatalog)
+		return;
+
+	mEntriesCatalog = entries;
+	RemoteCommanding::listCommandsUpdate(mEntriesCatalog, mTrieCmds);
+
+	if (!mKeyCatalog.size())
+		return;
+
+	if (!catalogSave(mKeyCatalog, mEntriesCatalog))
+		procWrnLog("could not store command catalog");
+}
+
 void GwMsgDispatching::processInfo(char *pBuf, char *pBufEnd)
 {
 #if 1
 	dInfo("State\t\t\t%s\n", ProcStateString[mState]);
 #endif
+	dInfo("Device\t\t\t%s\n", mDeviceUart.c_str());
+	dInfo("Ports\t\t\t%u, %u, %u\n",
+			mPortStart,
+			(uint16_t)(mPortStart + 2),
+			(uint16_t)(mPortStart + 4));
+	if (mpLstTap)
+		dInfo("UART tap\t\t%u\n", (uint16_t)(mPortStart + 6));
 	dInfo("Number of peers\t\t%zu\n", mListPeers.size());
+	dInfo("Catalog\t\t\t%s (%zu)\n", mKeyCatalog.c_str(), mEntriesCatalog.size());
 	dInfo("Refresh rate\t\t%u [ms]\n", env.rateRefreshMs);
+	dInfo("Process tree\t\t%zu nodes, gen %u / %u\n",
+			mTreeProc.size(), mTreeProc.gen(), mTreeProc.genStructure());
+	dInfo("Process history\t\t%zu frames, %zu bytes, %u spilled\n",
+			mHistProc.size(), mHistProc.sizeBytes(), mHistProc.cntSpilled());
+	if (mClockTarget.valid())
+		dInfo("Target clock\t\toffset %" PRId64 " [us], drift %.1f [ppm], %zu samples, %zu resets\n",
+				mClockTarget.offsetUs(), mClockTarget.driftPpm(),
+				mClockTarget.cntSamples(), mClockTarget.cntResets());
+	histogramInfoPrint(pBuf, pBufEnd, "Log target", mHistLogTarget);
+	histogramInfoPrint(pBuf, pBufEnd, "Log wire", mHistLogWire);
+	histogramInfoPrint(pBuf, pBufEnd, "Log gateway", mHistLogGateway);
+	dProfileInfo(mProfTick);
+	dAllocInfo(mAllocTick);
+}
+
+void GwMsgDispatching::metricsAdd(MetricFamilies &families) const
+{
+	static const char *namesType[] = { "proc", "log", "cmd", "tap" };
+	list<struct RemoteDebuggingPeer>::const_iterator iter;
+	string labels = "device=\"" + labelEscape(mDeviceUart) + "\"";
+	uint64_t cntPeers[cNumRemotePeerTypes] = { 0, 0, 0, 0 };
+	char bufId[24];
+
+	if (mpCtrl)
+		mpCtrl->metricsAdd(families, labels);
+
+	iter = mListPeers.begin();
+	for (; iter != mListPeers.end(); ++iter)
+	{
+		++cntPeers[iter->type];
+
+		if (iter->type == RemotePeerCmd)
+			continue;
+
+		snprintf(bufId, sizeof(bufId), "%u", iter->id);
+
+		metricAdd(families, "codeorb_peer_sent_bytes_total", MetricCounter,
+				"Bytes handed to the peer connection",
+				labels + ",type=\"" + namesType[iter->type] +
+				"\",peer=\"" + bufId + "\"",
+				iter->bytesSent);
+	}
+
+	for (size_t i = 0; i < cNumRemotePeerTypes; ++i)
+	{
+		metricAdd(families, "codeorb_peers", MetricGauge,
+				"Connected peers per channel",
+				labels + ",type=\"" + namesType[i] + "\"",
+				cntPeers[i]);
+	}
 }
 
 /* static functions */
@@ -27,16 +27,24 @@
 #define GW_MSG_DISPATCHING_H
 
 #include "Processing.h"
+#include "LibProfiling.h"
+#include "LibAllocTracking.h"
 #include "TcpListening.h"
 #include "TcpTransfering.h"
 #include "SingleWireScheduling.h"
 #include "RemoteCommanding.h"
 #include "InfoGathering.h"
+#include "ProcTree.h"
+#include "ProcHistory.h"
+#include "ClockTarget.h"
+#include "LibMetrics.h"
 
 enum RemotePeerType {
 	RemotePeerProc = 0,
 	RemotePeerLog,
 	RemotePeerCmd,
+	RemotePeerTap,
+	cNumRemotePeerTypes,
 };
 
 struct RemoteDebuggingPeer
@@ -44,6 +52,10 @@ struct RemoteDebuggingPeer
 	RemotePeerType type;
 	std::string typeDesc;
 	Processing *pProc;
+	SOCKET fd;
+	uint32_t id; // Unique per dispatcher. FDs are reused
+	uint64_t bytesSent;
+	uint32_t idFrameHist; // 0 => live
 };
 
 class GwMsgDispatching : public Processing
@@ -51,18 +63,24 @@ class GwMsgDispatching : public Processing
 
 public:
 
-	static GwMsgDispatching *create()
+	static GwMsgDispatching *create(const std::string &deviceUart, uint16_t portStart)
 	{
-		return new dNoThrow GwMsgDispatching;
+		return new dNoThrow GwMsgDispatching(deviceUart, portStart);
 	}
 
+	void metricsAdd(MetricFamilies &families) const;
+
+	// Owned by the dispatcher. Use from its tick only
+	const ProcTree &procTree() const { return mTreeProc; }
+
 protected:
 
-	GwMsgDispatching();
+	GwMsgDispatching(const std::string &deviceUart, uint16_t portStart);
 	virtual ~GwMsgDispatching() {}
 
 private:
 
+	GwMsgDispatching() = delete;
 	GwMsgDispatching(const GwMsgDispatching &) = delete;
 	GwMsgDispatching &operator=(const GwMsgDispatching &) = delete;
 
@@ -81,25 +99,56 @@ private:
 	bool servicesStart();
 	void peerListUpdate();
 	void contentDistribute();
+	void entryLogSend(const EntryLog &entry);
 	void contentSend(const std::string &str, RemotePeerType typePeer);
-	bool disconnectRequestedCheck(TcpTransfering *pTrans);
+	void peerSend(struct RemoteDebuggingPeer &peer, const std::string &str);
+	bool disconnectRequestedCheck(TcpTransfering *pTrans, std::string *pInput = NULL);
+	void historyScrub(struct RemoteDebuggingPeer &peer, const std::string &input);
 	void peerCheck();
+	void tapUpdate();
 	void peerAdd(TcpListening *pListener, enum RemotePeerType peerType, const char *pTypeDesc);
+	void catalogRestore();
+	void catalogStore(const std::list<std::string> &entries);
 
 	/* member variables */
 	//uint32_t mStartMs;
+	std::string mDeviceUart;
 	uint16_t mPortStart;
 	bool mListenLocal;
 	TcpListening *mpLstProc;
 	TcpListening *mpLstLog;
 	TcpListening *mpLstCmd;
+	TcpListening *mpLstTap;
 	SingleWireScheduling *mpCtrl;
 	InfoGathering *mpGather;
 	bool mCursorHidden;
 	bool mDevUartIsOnline;
 	bool mTargetIsOnline;
 	std::list<struct RemoteDebuggingPeer> mListPeers;
-
+	uint32_t mIdPeerNext;
+	CommandTrie mTrieCmds;
+	std::string mKeyCatalog;
+	std::list<std::string> mEntriesCatalog;
+	ContentShared mpContentProc;
+	std::string mContentHist;
+	std::string mChunkTap;
+	EntryLog mEntryLog;
+	std::string mEntryLogTimed;
+	ProcTree mTreeProc;
+	ProcHistory mHistProc;
+	ClockTarget mClockTarget;
+
+	// Latency of log entries in [us]
+	Histogram mHistLogWire;
+	Histogram mHistLogGateway;
+	Histogram mHistLogTarget;
+
+#if CONFIG_APP_HAVE_PROFILING
+	ProfileTick mProfTick;
+#endif
+#if CONFIG_APP_HAVE_ALLOC_TRACKING
+	AllocStats mAllocTick;
+#endif
 	/* static functions */
 
 	/* static variables */
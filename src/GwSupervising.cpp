@@ -26,11 +26,19 @@
 #if defined(__linux__)
 #include <unistd.h>
 #include <signal.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
 #endif
 
 #include "GwSupervising.h"
 #include "SystemDebugging.h"
+#include "MetricsServing.h"
 #include "LibFilesys.h"
+#include "LibTime.h"
+#include "LibFlightRec.h"
 
 #include "env.h"
 
@@ -60,27 +68,61 @@ dProcessStateStr(SdState);
 
 using namespace std;
 
+typedef list<GwMsgDispatching *>::iterator AppIter;
+
 #if defined(__linux__)
-static Processing *pTreeRoot = NULL;
+const size_t cSizeSnapshot = 2*1024*1024;
+/*
+ * A saved tree can be up to this old. Each refresh renders
+ * the whole tree like the 'tree' command does, so it runs
+ * rarely rather than on every state change
+ */
+const uint32_t cIntervalSnapshotMs = 500;
+
 static char nameApp[16];
-static char nameFileProc[64];
-static char buffProcTree[2*1024*1024];
-static bool procTreeSaveInProgress = false;
+static char nameFileSnapshot[64];
+static int fdSnapshot = -1;
+static char *pSnapshot = NULL;
+static volatile sig_atomic_t lenSnapshot = 0;
+static volatile sig_atomic_t snapshotSaved = 0;
+static volatile sig_atomic_t procTreeSaveInProgress = 0;
+#endif
+
+#if CONFIG_APP_HAVE_PROFILING
+ProfileTick GwSupervising::profTreeTick;
 #endif
 
 GwSupervising::GwSupervising()
 	: Processing("GwSupervising")
 	//, mStartMs(0)
 	, mStateSd(StSdStart)
-	, mpApp(NULL)
+	, mListApps()
+#if defined(__linux__)
+	, mSnapshotMs(0)
+#endif
+#if CONFIG_APP_HAVE_PROFILING
+	, mProfTick()
+#endif
+#if CONFIG_APP_HAVE_ALLOC_TRACKING
+	, mAllocTick()
+#endif
 {
 	mState = StStart;
 }
 
+GwSupervising::~GwSupervising()
+{
+#if defined(__linux__)
+	snapshotDestroy();
+#endif
+}
+
 /* member functions */
 
 Success GwSupervising::process()
 {
+	dProfileTick(mProfTick);
+	dAllocTick(mAllocTick);
 	//uint32_t curTimeMs = millis();
 	//uint32_t diffMs = curTimeMs - mStartMs;
 	//Success success;
@@ -100,7 +142,9 @@ Success GwSupervising::process()
 
 		break;
 	case StMain:
-
+#if defined(__linux__)
+		snapshotUpdate();
+#endif
 		break;
 	default:
 		break;
@@ -111,20 +155,30 @@ Success GwSupervising::process()
 
 Success GwSupervising::shutdown()
 {
+	AppIter iter;
+
 	switch (mStateSd)
 	{
 	case StSdStart:
 
-		cancel(mpApp);
+		iter = mListApps.begin();
+		for (; iter != mListApps.end(); ++iter)
+			cancel(*iter);
 
 		mStateSd = StSdAppDoneWait;
 
 		break;
 	case StSdAppDoneWait:
 
-		if (mpApp->progress())
-			break;
-
+		iter = mListApps.begin();
+		for (; iter != mListApps.end(); ++iter)
+		{
+			if ((*iter)->progress())
+				return Pending;
+		}
+#if defined(__linux__)
+		snapshotDestroy();
+#endif
 		return Positive;
 
 		break;
@@ -136,81 +190,215 @@ Success GwSupervising::shutdown()
 }
 
 #if defined(__linux__)
-static void procTreeSave()
+static size_t strAppend(char *pBuf, char *pBufEnd, const char *pStr)
 {
-	time_t now;
-	FILE *pFile;
-	int res;
-	size_t lenReq, lenDone;
-	string strTime;
+	char *pStart = pBuf;
 
-	if (procTreeSaveInProgress)
-		return;
-	procTreeSaveInProgress = true;
+	for (; *pStr && pBuf < pBufEnd; ++pStr, ++pBuf)
+		*pBuf = *pStr;
 
-	now = time(NULL);
+	return pBuf - pStart;
+}
+
+static size_t uintAppend(char *pBuf, char *pBufEnd, uint64_t val)
+{
+	char digits[21];
+	size_t len = 0;
 
-	if (!pTreeRoot)
+	do
 	{
-		wrnLog("process tree root not defined");
-		return;
-	}
+		digits[len++] = '0' + val % 10;
+		val /= 10;
+	} while (val);
 
-	*buffProcTree = 0;
+	for (size_t i = 0; i < len && pBuf + i < pBufEnd; ++i)
+		pBuf[i] = digits[len - 1 - i];
 
-	pTreeRoot->processTreeStr(
-		buffProcTree,
-		buffProcTree + sizeof(buffProcTree),
-		true,
-		true);
+	return len;
+}
 
-	strTime = to_string(now);
-	res = snprintf(nameFileProc, sizeof(nameFileProc),
-			"%s_%s_tree-proc.txt",
-			strTime.c_str(),
-			nameApp);
-	if (res < 0)
-	{
-		wrnLog("could not create process tree file name");
+static void msgWrite(const char *pMsg)
+{
+	ssize_t res;
+
+	res = write(STDERR_FILENO, pMsg, strlen(pMsg));
+	(void)res;
+}
+
+/*
+ * Runs in the signal handler => Async-signal-safe only.
+ * The tree has already been rendered into the mapped
+ * file. Only cut it to size and give it its final name
+ */
+static void procTreeSave()
+{
+	char nameFile[64];
+	char *pBuf = nameFile;
+	char *pBufEnd = nameFile + sizeof(nameFile) - 1;
+
+	if (procTreeSaveInProgress)
 		return;
-	}
+	procTreeSaveInProgress = 1;
 
-	pFile = fopen(nameFileProc, "w");
-	if (!pFile)
+	if (!pSnapshot || snapshotSaved)
 	{
-		wrnLog("could not open process tree file");
+		msgWrite("process tree snapshot not available\n");
+		procTreeSaveInProgress = 0;
 		return;
 	}
 
-	lenReq = strlen(buffProcTree);
-	lenDone = fwrite(buffProcTree, 1, lenReq, pFile);
+	msync(pSnapshot, cSizeSnapshot, MS_SYNC);
+
+	if (ftruncate(fdSnapshot, lenSnapshot))
+		msgWrite("could not truncate process tree file\n");
 
-	fclose(pFile);
+	pBuf += uintAppend(pBuf, pBufEnd, time(NULL));
+	pBuf += strAppend(pBuf, pBufEnd, "_");
+	pBuf += strAppend(pBuf, pBufEnd, nameApp);
+	pBuf += strAppend(pBuf, pBufEnd, "_tree-proc.txt");
+	*pBuf = 0;
 
-	if (lenDone != lenReq)
+	if (rename(nameFileSnapshot, nameFile))
+		msgWrite("could not rename process tree file\n");
+
+	// File is cut => No more updates
+	snapshotSaved = 1;
+	procTreeSaveInProgress = 0;
+}
+
+// Async-signal-safe as well
+static void flightSave()
+{
+	char nameFile[64];
+	char *pBuf = nameFile;
+	char *pBufEnd = nameFile + sizeof(nameFile) - 1;
+	int fd;
+
+	pBuf += uintAppend(pBuf, pBufEnd, time(NULL));
+	pBuf += strAppend(pBuf, pBufEnd, "_");
+	pBuf += strAppend(pBuf, pBufEnd, nameApp);
+	pBuf += strAppend(pBuf, pBufEnd, "_flight.txt");
+	*pBuf = 0;
+
+	fd = open(nameFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
 	{
-		wrnLog("error writing to process tree file");
+		msgWrite("could not open flight recorder file\n");
 		return;
 	}
+
+	flightDump(fd);
+	close(fd);
 }
 
 // - https://man7.org/linux/man-pages/man5/core.5.html
 // - https://man7.org/linux/man-pages/man7/signal.7.html
+// - https://man7.org/linux/man-pages/man7/signal-safety.7.html
 // - https://man7.org/linux/man-pages/man3/abort.3.html
 void coreDumpRequest(int signum)
 {
-	wrnLog("Got signal: %d", signum);
-
 	if (signum != SIGABRT)
 	{
-		wrnLog("Requesting core dump");
+		msgWrite("Requesting core dump\n");
 		abort();
 
 		return;
 	}
 
-	wrnLog("Creating process tree file");
+	msgWrite("Creating process tree file\n");
 	procTreeSave();
+
+	msgWrite("Creating flight recorder file\n");
+	flightSave();
+}
+
+/*
+ * The file is mapped once and kept up to date during
+ * normal operation. Pages are only backed as far as
+ * the tree actually reaches
+ */
+bool GwSupervising::snapshotCreate()
+{
+	void *pMap;
+	int fd;
+
+	snprintf(nameApp, sizeof(nameApp), "%s", dAppName);
+	// Several instances may run in the same directory
+	snprintf(nameFileSnapshot, sizeof(nameFileSnapshot),
+				"%s_%d_tree-proc.snapshot", nameApp, getpid());
+
+	fd = open(nameFileSnapshot, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+	{
+		procWrnLog("could not open snapshot file: %s", strerror(errno));
+		return false;
+	}
+
+	if (ftruncate(fd, cSizeSnapshot))
+	{
+		procWrnLog("could not resize snapshot file: %s", strerror(errno));
+		close(fd);
+		return false;
+	}
+
+	pMap = mmap(NULL, cSizeSnapshot, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (pMap == MAP_FAILED)
+	{
+		procWrnLog("could not map snapshot file: %s", strerror(errno));
+		close(fd);
+		return false;
+	}
+
+	fdSnapshot = fd;
+	pSnapshot = (char *)pMap;
+
+	return true;
+}
+
+void GwSupervising::snapshotUpdate()
+{
+	uint32_t curTimeMs = millis();
+	size_t lenOld = lenSnapshot;
+	size_t len;
+
+	if (!pSnapshot || snapshotSaved)
+		return;
+
+	if (curTimeMs - mSnapshotMs < cIntervalSnapshotMs)
+		return;
+	mSnapshotMs = curTimeMs;
+
+	*pSnapshot = 0;
+
+	processTreeStr(pSnapshot, pSnapshot + cSizeSnapshot - 1, true, true);
+
+	len = strnlen(pSnapshot, cSizeSnapshot - 1);
+
+	// Leftovers of a longer tree
+	if (len < lenOld)
+		memset(pSnapshot + len, 0, lenOld - len);
+
+	lenSnapshot = len;
+}
+
+// Clean exit => Nothing to keep
+void GwSupervising::snapshotDestroy()
+{
+	char *pMap = pSnapshot;
+
+	if (!pMap)
+		return;
+
+	// Signal handler must not touch it anymore
+	pSnapshot = NULL;
+
+	munmap(pMap, cSizeSnapshot);
+	close(fdSnapshot);
+	fdSnapshot = -1;
+
+	// Already renamed by the signal handler otherwise
+	if (!snapshotSaved)
+		unlink(nameFileSnapshot);
 }
 #endif
 
@@ -223,6 +411,10 @@ bool GwSupervising::servicesStart()
 	{
 		procWrnLog("enable core dumps");
 
+		ok = snapshotCreate();
+		if (!ok)
+			procWrnLog("process tree snapshots disabled");
+
 		signal(SIGABRT, coreDumpRequest);
 
 		ok = coreDumpsEnable(coreDumpRequest);
@@ -245,24 +437,67 @@ bool GwSupervising::servicesStart()
 	pDbg->procTreeDisplaySet(false);
 	start(pDbg);
 
-	mpApp = GwMsgDispatching::create();
-	if (!mpApp)
+	fprintf(stdout, "CodeOrb-25.04-1\n");
+
+	if (env.ctrlManual)
+		fprintf(stdout, "Manual control enabled\n");
+
+	GwMsgDispatching *pApp;
+	vector<string>::const_iterator iter;
+	uint16_t portStart = env.startPortsTarget;
+
+	iter = env.devicesUart.begin();
+	for (; iter != env.devicesUart.end(); ++iter)
+	{
+		pApp = GwMsgDispatching::create(*iter, portStart);
+		if (!pApp)
+		{
+			procWrnLog("could not create process");
+			return false;
+		}
+
+		start(pApp);
+		mListApps.push_back(pApp);
+
+		portStart += cNumPortsPerTarget;
+	}
+
+	if (!env.portMetrics)
+		return true;
+
+	MetricsServing *pMetrics;
+
+	pMetrics = MetricsServing::create(env.portMetrics, &mListApps);
+	if (!pMetrics)
 	{
 		procWrnLog("could not create process");
 		return false;
 	}
 
-	start(mpApp);
+	start(pMetrics);
 
 	return true;
 }
 
 void GwSupervising::processInfo(char *pBuf, char *pBufEnd)
 {
-	(void)pBuf;
-	(void)pBufEnd;
 #if 0
 	dInfo("State\t\t\t%s\n", ProcStateString[mState]);
+#endif
+	dInfo("Targets\t\t\t%zu\n", mListApps.size());
+#if defined(__linux__)
+	if (pSnapshot)
+		dInfo("Snapshot\t\t%s (%zu bytes)\n",
+				nameFileSnapshot, (size_t)lenSnapshot);
+#endif
+	dProfileInfo(mProfTick);
+	dAllocInfo(mAllocTick);
+#if CONFIG_APP_HAVE_PROFILING
+	histogramInfoPrint(pBuf, pBufEnd, "Tree tick", profTreeTick);
+#endif
+#if CONFIG_APP_HAVE_ALLOC_TRACKING
+	dInfo("Outside of own ticks\n");
+	allocInfoPrint(pBuf, pBufEnd, allocStatsOther);
 #endif
 }
 
@@ -26,7 +26,11 @@
 #ifndef GW_SUPERVISING_H
 #define GW_SUPERVISING_H
 
+#include <list>
+
 #include "Processing.h"
+#include "LibProfiling.h"
+#include "LibAllocTracking.h"
 #include "GwMsgDispatching.h"
 
 class GwSupervising : public Processing
@@ -39,10 +43,15 @@ public:
 		return new dNoThrow GwSupervising;
 	}
 
+#if CONFIG_APP_HAVE_PROFILING
+	// Whole tree including processes we don't own
+	static ProfileTick profTreeTick;
+#endif
+
 protected:
 
 	GwSupervising();
-	virtual ~GwSupervising() {}
+	virtual ~GwSupervising();
 
 private:
 
@@ -60,12 +69,26 @@ private:
 	void processInfo(char *pBuf, char *pBufEnd);
 
 	bool servicesStart();
+#if defined(__linux__)
+	bool snapshotCreate();
+	void snapshotUpdate();
+	void snapshotDestroy();
+#endif
 
 	/* member variables */
 	//uint32_t mStartMs;
 	uint32_t mStateSd;
-	GwMsgDispatching *mpApp;
+	std::list<GwMsgDispatching *> mListApps;
+#if defined(__linux__)
+	uint32_t mSnapshotMs;
+#endif
 
+#if CONFIG_APP_HAVE_PROFILING
+	ProfileTick mProfTick;
+#endif
+#if CONFIG_APP_HAVE_ALLOC_TRACKING
+	AllocStats mAllocTick;
+#endif
 	/* static functions */
 
 	/* static variables */
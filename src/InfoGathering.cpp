@@ -24,12 +24,14 @@
 */
 
 #include "InfoGathering.h"
-#include "SingleWireScheduling.h"
 
 #include "LibTime.h"
+#include "LibWakeup.h"
 
 #define dForEach_ProcState(gen) \
 		gen(StStart) \
+		gen(StBulkSend) \
+		gen(StBulkRespWait) \
 		gen(StCmdSend) \
 		gen(StRespCmdWait) \
 
@@ -45,12 +47,37 @@ using namespace std;
 
 const uint8_t cCntFiltMax = 4;
 
-InfoGathering::InfoGathering()
+/*
+ * Bulk catalog
+ * Request:  infoHelpAll [index of first entry]
+ * Response: Entries separated by '\n'. If the table
+ *           didn't fit into one frame the last line
+ *           is '+<index of next entry>'
+ * Targets without support answer with something
+ * that is not an entry => Fallback to infoHelp
+ */
+const string cCmdBulk = "infoHelpAll";
+const uint32_t cTimeoutBulkMs = 1000;
+const uint32_t cNumPagesBulkMax = 64;
+
+InfoGathering::InfoGathering(SingleWireScheduling *pCtrl)
 	: Processing("InfoGathering")
 	, mEntriesReceived()
 	, mStartMs(0)
+	, mpCtrl(pCtrl)
+	, mIdSession(SingleWireScheduling::sessionIdCreate())
 	, mIdReq(0)
 	, mCntFilt(0)
+	, mEntriesSeen()
+	, mIdxBulkNext(0)
+	, mCntPagesBulk(0)
+	, mBulkUsed(false)
+#if CONFIG_APP_HAVE_PROFILING
+	, mProfTick()
+#endif
+#if CONFIG_APP_HAVE_ALLOC_TRACKING
+	, mAllocTick()
+#endif
 {
 	mState = StStart;
 }
@@ -61,6 +88,8 @@ const uint32_t cTimeoutResponseMs = 3300;
 
 Success InfoGathering::process()
 {
+	dProfileTick(mProfTick);
+	dAllocTick(mAllocTick);
 	uint32_t curTimeMs = millis();
 	uint32_t diffMs = curTimeMs - mStartMs;
 	Success success;
@@ -73,13 +102,63 @@ Success InfoGathering::process()
 	case StStart:
 
 		mEntriesReceived.clear();
+		mEntriesSeen.clear();
+
+		mIdxBulkNext = 0;
+		mCntPagesBulk = 0;
+		mBulkUsed = false;
+
+		mState = StBulkSend;
+
+		break;
+	case StBulkSend:
+
+		if (!bulkRequest())
+			return procErrLog(-1, "could not send command");
+
+		mStartMs = curTimeMs;
+		mState = StBulkRespWait;
+
+		break;
+	case StBulkRespWait:
+
+		if (diffMs > cTimeoutBulkMs)
+		{
+			procDbgLog("no bulk catalog. Falling back to single entries");
+
+			// Pages received so far are incomplete
+			bulkDiscard();
+
+			mState = StCmdSend;
+			break;
+		}
+
+		success = bulkPageGet();
+		if (success == Pending)
+		{
+			wakeupDeadlineSet(mStartMs + cTimeoutBulkMs + 1);
+			break;
+		}
+
+		if (success == Positive)
+		{
+			mState = StBulkSend;
+			break;
+		}
+
+		if (mBulkUsed)
+			return Positive;
+
+		// Not supported by target or aborted
+		bulkDiscard();
 
 		mState = StCmdSend;
 
 		break;
 	case StCmdSend:
 
-		ok = SingleWireScheduling::commandSend("infoHelp", mIdReq, PrioSysLow);
+		ok = mpCtrl->commandSend("infoHelp", mIdReq, PrioSysLow,
+						mIdSession, cTimeoutResponseMs);
 		if (!ok)
 			return procErrLog(-1, "could not send command");
 
@@ -106,7 +185,11 @@ Success InfoGathering::process()
 
 		success = entryNewGet();
 		if (success == Pending)
+		{
+			// Responses wake us up. Timeout must as well
+			wakeupDeadlineSet(mStartMs + cTimeoutResponseMs + 1);
 			break;
+		}
 
 		if (success == Positive)
 		{
@@ -134,41 +217,114 @@ Success InfoGathering::process()
 	return Pending;
 }
 
+bool InfoGathering::bulkRequest()
+{
+	string cmd = cCmdBulk;
+
+	if (mIdxBulkNext)
+		cmd += " " + to_string(mIdxBulkNext);
+
+	return mpCtrl->commandSend(cmd, mIdReq, PrioSysLow,
+						mIdSession, cTimeoutBulkMs);
+}
+
+/*
+ * Positive => Next page required
+ * Negative => Done. Check mBulkUsed
+ *
+ * mBulkUsed is only left set for a complete catalog
+ */
+Success InfoGathering::bulkPageGet()
+{
+	string resp, line;
+	size_t posStart, posEnd;
+	bool more = false;
+
+	if (!mpCtrl->commandResponseGet(mIdReq, resp))
+		return Pending;
+
+	posStart = 0;
+	while (posStart < resp.size())
+	{
+		posEnd = resp.find('\n', posStart);
+		if (posEnd == string::npos)
+			posEnd = resp.size();
+
+		line = resp.substr(posStart, posEnd - posStart);
+		posStart = posEnd + 1;
+
+		if (!line.size())
+			continue;
+
+		if (line[0] == '+' && posStart >= resp.size())
+		{
+			mIdxBulkNext = strtoul(line.c_str() + 1, NULL, 10);
+			more = true;
+			break;
+		}
+
+		// Entry format: id|shortcut|desc|group
+		if (line.find('|') == string::npos)
+		{
+			bulkDiscard();
+			return -1;
+		}
+
+		mBulkUsed = true;
+		entryAdd(line);
+	}
+
+	++mCntPagesBulk;
+
+	if (!more || !mBulkUsed)
+		return -1;
+
+	if (mCntPagesBulk >= cNumPagesBulkMax)
+	{
+		procWrnLog("too many catalog pages");
+		bulkDiscard();
+		return -1;
+	}
+
+	return Positive;
+}
+
+void InfoGathering::bulkDiscard()
+{
+	mEntriesReceived.clear();
+	mEntriesSeen.clear();
+
+	mBulkUsed = false;
+}
+
 Success InfoGathering::entryNewGet()
 {
 	string resp;
 	bool ok;
 
-	ok = SingleWireScheduling::commandResponseGet(mIdReq, resp);
+	ok = mpCtrl->commandResponseGet(mIdReq, resp);
 	if (!ok)
 		return Pending;
 
 	//procWrnLog("response received: %s", resp.c_str());
 	mCntFilt = 0;
 
-	ok = entryFound(resp);
-	if (ok)
+	ok = entryAdd(resp);
+	if (!ok)
 		return -1;
 
-	mEntriesReceived.push_back(resp);
-
 	return Positive;
 }
 
-bool InfoGathering::entryFound(const string &entry)
+// Returns false for duplicates
+bool InfoGathering::entryAdd(const string &entry)
 {
-	list<string>::iterator iter;
+	if (!mEntriesSeen.insert(entry).second)
+		return false;
 
-	iter = mEntriesReceived.begin();
-	for (; iter != mEntriesReceived.end(); ++iter)
-	{
-		if (*iter != entry)
-			continue;
-
-		return true;
-	}
+	mEntriesReceived.push_back(entry);
 
-	return false;
+	return true;
 }
 
 void InfoGathering::processInfo(char *pBuf, char *pBufEnd)
@@ -176,6 +332,11 @@ void InfoGathering::processInfo(char *pBuf, char *pBufEnd)
 #if 1
 	dInfo("State\t\t\t%s\n", ProcStateString[mState]);
 #endif
+	dInfo("Bulk catalog\t\t%s\n", mBulkUsed ? "Yes" : "No");
+	dInfo("Pages\t\t\t%u\n", mCntPagesBulk);
+	dInfo("Entries\t\t\t%zu\n", mEntriesReceived.size());
+	dProfileInfo(mProfTick);
+	dAllocInfo(mAllocTick);
 }
 
 /* static functions */
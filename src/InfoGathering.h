@@ -28,28 +28,33 @@
 
 #include <string>
 #include <list>
+#include <unordered_set>
 
 #include "Processing.h"
+#include "LibProfiling.h"
+#include "LibAllocTracking.h"
+#include "SingleWireScheduling.h"
 
 class InfoGathering : public Processing
 {
 
 public:
 
-	static InfoGathering *create()
+	static InfoGathering *create(SingleWireScheduling *pCtrl)
 	{
-		return new dNoThrow InfoGathering;
+		return new dNoThrow InfoGathering(pCtrl);
 	}
 
 	std::list<std::string> mEntriesReceived;
 
 protected:
 
-	InfoGathering();
+	InfoGathering(SingleWireScheduling *pCtrl);
 	virtual ~InfoGathering() {}
 
 private:
 
+	InfoGathering() = delete;
 	InfoGathering(const InfoGathering &) = delete;
 	InfoGathering &operator=(const InfoGathering &) = delete;
 
@@ -62,15 +67,30 @@ private:
 	Success process();
 	void processInfo(char *pBuf, char *pBufEnd);
 
+	bool bulkRequest();
+	Success bulkPageGet();
+	void bulkDiscard();
 	Success entryNewGet();
-	bool entryFound(const std::string &entry);
+	bool entryAdd(const std::string &entry);
 
 	/* member variables */
 	uint32_t mStartMs;
+	SingleWireScheduling *mpCtrl;
+	uint32_t mIdSession;
 	uint32_t mIdReq;
 	std::string mResp;
 	uint8_t mCntFilt;
+	std::unordered_set<std::string> mEntriesSeen;
+	uint32_t mIdxBulkNext;
+	uint32_t mCntPagesBulk;
+	bool mBulkUsed;
 
+#if CONFIG_APP_HAVE_PROFILING
+	ProfileTick mProfTick;
+#endif
+#if CONFIG_APP_HAVE_ALLOC_TRACKING
+	AllocStats mAllocTick;
+#endif
 	/* static functions */
 
 	/* static variables */
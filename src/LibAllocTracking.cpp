@@ -0,0 +1,152 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdlib>
+#include <new>
+
+#include "LibAllocTracking.h"
+#include "Processing.h"
+
+using namespace std;
+
+AllocStats allocStatsOther;
+
+AllocStats::AllocStats()
+	: cntAlloc(0)
+	, cntFree(0)
+	, bytesAlloc(0)
+	, histTick()
+{
+}
+
+void allocInfoPrint(char *&pBuf, char *pBufEnd, const AllocStats &stats)
+{
+	const Histogram &hist = stats.histTick;
+	uint64_t cnt = hist.count();
+	uint64_t avg = cnt ? hist.sum() / cnt : 0;
+
+	dInfo("Allocations\n");
+	dInfo("  New / Delete\t\t%llu / %llu\n",
+			(unsigned long long)stats.cntAlloc.load(memory_order_relaxed),
+			(unsigned long long)stats.cntFree.load(memory_order_relaxed));
+	dInfo("  Bytes\t\t\t%llu\n",
+			(unsigned long long)stats.bytesAlloc.load(memory_order_relaxed));
+	dInfo("  Per tick Avg / p50 / p99 / Max\t%llu / %llu / %llu / %llu\n",
+			(unsigned long long)avg,
+			(unsigned long long)hist.percentile(500),
+			(unsigned long long)hist.percentile(990),
+			(unsigned long long)hist.max());
+}
+
+#if CONFIG_APP_HAVE_ALLOC_TRACKING
+static thread_local AllocStats *pStatsCur = NULL;
+
+AllocScope::AllocScope(AllocStats &stats)
+	: mStats(stats)
+	, mpStatsPrev(pStatsCur)
+	, mCntStart(stats.cntAlloc.load(memory_order_relaxed))
+{
+	pStatsCur = &stats;
+}
+
+AllocScope::~AllocScope()
+{
+	pStatsCur = mpStatsPrev;
+	mStats.histTick.add(mStats.cntAlloc.load(memory_order_relaxed) - mCntStart);
+}
+
+static void *allocCount(size_t size)
+{
+	AllocStats *pStats = pStatsCur ? pStatsCur : &allocStatsOther;
+
+	pStats->cntAlloc.fetch_add(1, memory_order_relaxed);
+	pStats->bytesAlloc.fetch_add(size, memory_order_relaxed);
+
+	return malloc(size ? size : 1);
+}
+
+static void freeCount(void *p)
+{
+	if (!p)
+		return;
+
+	AllocStats *pStats = pStatsCur ? pStatsCur : &allocStatsOther;
+
+	pStats->cntFree.fetch_add(1, memory_order_relaxed);
+
+	free(p);
+}
+
+void *operator new(size_t size)
+{
+	void *p = allocCount(size);
+
+	if (!p)
+		throw bad_alloc();
+
+	return p;
+}
+
+void *operator new[](size_t size)
+{
+	void *p = allocCount(size);
+
+	if (!p)
+		throw bad_alloc();
+
+	return p;
+}
+
+void *operator new(size_t size, const nothrow_t &) noexcept
+{
+	return allocCount(size);
+}
+
+void *operator new[](size_t size, const nothrow_t &) noexcept
+{
+	return allocCount(size);
+}
+
+void operator delete(void *p) noexcept
+{
+	freeCount(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	freeCount(p);
+}
+
+void operator delete(void *p, const nothrow_t &) noexcept
+{
+	freeCount(p);
+}
+
+void operator delete[](void *p, const nothrow_t &) noexcept
+{
+	freeCount(p);
+}
+#endif
+
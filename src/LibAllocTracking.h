@@ -0,0 +1,101 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIB_ALLOC_TRACKING_H
+#define LIB_ALLOC_TRACKING_H
+
+#include "LibProfiling.h"
+
+#ifndef CONFIG_APP_HAVE_ALLOC_TRACKING
+#define CONFIG_APP_HAVE_ALLOC_TRACKING 0
+#endif
+
+/*
+ * Allocation tracking. Opt-in at build time.
+ *
+ * The global operator new and delete are replaced.
+ * Each allocation is attributed to the process whose
+ * process() is running on the current thread. All
+ * others, like the ones of the core processes, are
+ * collected in allocStatsOther.
+ *
+ * Usage
+ *   Header:  #if CONFIG_APP_HAVE_ALLOC_TRACKING
+ *            AllocStats mAllocTick;
+ *            #endif
+ *   Process: dAllocTick(mAllocTick);
+ *   Info:    dAllocInfo(mAllocTick);
+ */
+struct AllocStats
+{
+	AllocStats();
+
+	std::atomic<uint64_t> cntAlloc;
+	std::atomic<uint64_t> cntFree;
+	std::atomic<uint64_t> bytesAlloc;
+
+	// Allocations per process() call
+	Histogram histTick;
+
+private:
+
+	AllocStats(const AllocStats &) = delete;
+	AllocStats &operator=(const AllocStats &) = delete;
+
+};
+
+extern AllocStats allocStatsOther;
+
+void allocInfoPrint(char *&pBuf, char *pBufEnd, const AllocStats &stats);
+
+#if CONFIG_APP_HAVE_ALLOC_TRACKING
+class AllocScope
+{
+
+public:
+
+	AllocScope(AllocStats &stats);
+	~AllocScope();
+
+private:
+
+	AllocScope(const AllocScope &) = delete;
+	AllocScope &operator=(const AllocScope &) = delete;
+
+	AllocStats &mStats;
+	AllocStats *mpStatsPrev;
+	uint64_t mCntStart;
+
+};
+
+#define dAllocTick(s)		AllocScope allocScope(s)
+#define dAllocInfo(s)		allocInfoPrint(pBuf, pBufEnd, s)
+#else
+#define dAllocTick(s)
+#define dAllocInfo(s)
+#endif
+
+#endif
+
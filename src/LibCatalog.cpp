@@ -0,0 +1,211 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <cinttypes>
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "LibCatalog.h"
+
+using namespace std;
+
+static bool dirCacheGet(string &dir);
+static string fileCatalogGet(const string &dir, const string &key);
+static uint32_t fnv1a(const string &str);
+static bool lineRead(FILE *pFile, string &line);
+
+bool catalogLoad(const string &key, list<string> &entries)
+{
+	string dir, line;
+	FILE *pFile;
+	bool ok;
+
+	entries.clear();
+
+	if (!key.size() || !dirCacheGet(dir))
+		return false;
+
+	pFile = fopen(fileCatalogGet(dir, key).c_str(), "r");
+	if (!pFile)
+		return false;
+
+	// First line holds the key. Protects against hash collisions
+	ok = lineRead(pFile, line) && line == key;
+
+	while (ok && lineRead(pFile, line))
+	{
+		if (!line.size())
+			continue;
+
+		entries.push_back(line);
+	}
+
+	fclose(pFile);
+
+	if (!ok)
+		entries.clear();
+
+	return ok && entries.size();
+}
+
+bool catalogSave(const string &key, const list<string> &entries)
+{
+	string dir, file, fileTmp;
+	list<string>::const_iterator iter;
+	FILE *pFile;
+	bool ok;
+	int res;
+
+	if (!key.size() || !dirCacheGet(dir))
+		return false;
+
+	file = fileCatalogGet(dir, key);
+	fileTmp = file + ".tmp";
+
+	pFile = fopen(fileTmp.c_str(), "w");
+	if (!pFile)
+		return false;
+
+	ok = fprintf(pFile, "%s\n", key.c_str()) > 0;
+
+	iter = entries.begin();
+	for (; ok && iter != entries.end(); ++iter)
+		ok = fprintf(pFile, "%s\n", iter->c_str()) > 0;
+
+	res = fclose(pFile);
+	if (!ok || res)
+	{
+		remove(fileTmp.c_str());
+		return false;
+	}
+
+	// Readers never see partial files
+#if defined(_WIN32)
+	remove(file.c_str());
+#endif
+	res = rename(fileTmp.c_str(), file.c_str());
+	if (res)
+	{
+		remove(fileTmp.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+/* static functions */
+
+bool dirCacheGet(string &dir)
+{
+	const char *pEnv;
+	int res;
+
+#if defined(_WIN32)
+	pEnv = getenv("LOCALAPPDATA");
+	if (!pEnv || !*pEnv)
+		return false;
+
+	dir = string(pEnv) + "\\codeorb";
+
+	res = _mkdir(dir.c_str());
+#else
+	pEnv = getenv("XDG_CACHE_HOME");
+	if (pEnv && *pEnv)
+		dir = pEnv;
+	else
+	{
+		pEnv = getenv("HOME");
+		if (!pEnv || !*pEnv)
+			return false;
+
+		dir = string(pEnv) + "/.cache";
+		(void)mkdir(dir.c_str(), 0755);
+	}
+
+	dir += "/codeorb";
+
+	res = mkdir(dir.c_str(), 0755);
+#endif
+	if (res && errno != EEXIST)
+		return false;
+
+	return true;
+}
+
+string fileCatalogGet(const string &dir, const string &key)
+{
+	char buf[32];
+
+	snprintf(buf, sizeof(buf), "catalog-%08" PRIx32 ".txt", fnv1a(key));
+
+#if defined(_WIN32)
+	return dir + "\\" + buf;
+#else
+	return dir + "/" + buf;
+#endif
+}
+
+// https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function
+uint32_t fnv1a(const string &str)
+{
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < str.size(); ++i)
+	{
+		hash ^= (uint8_t)str[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+bool lineRead(FILE *pFile, string &line)
+{
+	int ch;
+
+	line.clear();
+
+	while (1)
+	{
+		ch = fgetc(pFile);
+		if (ch == EOF)
+			return line.size() > 0;
+
+		if (ch == '\n')
+			return true;
+
+		if (ch == '\r')
+			continue;
+
+		line.push_back((char)ch);
+	}
+}
+
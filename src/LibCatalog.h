@@ -0,0 +1,43 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIB_CATALOG_H
+#define LIB_CATALOG_H
+
+#include <string>
+#include <list>
+
+/*
+ * Command catalogs of targets stored on disk. The key
+ * identifies the firmware. Each key has its own file
+ * in the cache directory of the user
+ * - UNIX:    $XDG_CACHE_HOME/codeorb or ~/.cache/codeorb
+ * - Windows: %LOCALAPPDATA%\codeorb
+ */
+bool catalogLoad(const std::string &key, std::list<std::string> &entries);
+bool catalogSave(const std::string &key, const std::list<std::string> &entries);
+
+#endif
+
@@ -0,0 +1,273 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include <atomic>
+#include <cstring>
+
+#include "LibFlightRec.h"
+#include "LibProfiling.h"
+
+using namespace std;
+
+#define dGenFlightEventString(s) #s,
+static const char *FlightEventTypeString[] =
+{
+	dForEach_FlightEvent(dGenFlightEventString)
+};
+
+const size_t cNumSlotsFlight = 4096;
+const size_t cSizeDataFlight = 20;
+const size_t cSizeLineFlight = 160;
+
+// 32 bytes
+struct FlightSlot
+{
+	atomic<uint32_t> seq; // 0 while being written
+	uint32_t timeUs;
+	uint8_t type;
+	uint8_t idSrc;
+	uint8_t len;
+	uint8_t reserved;
+	uint8_t data[cSizeDataFlight];
+};
+
+static FlightSlot slotsFlight[cNumSlotsFlight];
+static atomic<uint32_t> idxFlightNext(0);
+static atomic<uint8_t> idSrcFlightNext(0);
+
+static const char * const *namesFlight[cNumFlightEventTypes];
+static size_t cntNamesFlight[cNumFlightEventTypes];
+
+uint8_t flightSourceCreate()
+{
+	return idSrcFlightNext.fetch_add(1, memory_order_relaxed);
+}
+
+void flightNamesSet(FlightEventType type, const char * const *pNames, size_t cntNames)
+{
+	if (type >= cNumFlightEventTypes)
+		return;
+
+	namesFlight[type] = pNames;
+	cntNamesFlight[type] = cntNames;
+}
+
+static void slotWrite(FlightEventType type, uint8_t idSrc, uint32_t timeUs,
+						const uint8_t *pData, size_t len)
+{
+	uint32_t idx = idxFlightNext.fetch_add(1, memory_order_relaxed);
+	FlightSlot &slot = slotsFlight[idx & (cNumSlotsFlight - 1)];
+
+	slot.seq.store(0, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	slot.timeUs = timeUs;
+	slot.type = type;
+	slot.idSrc = idSrc;
+	slot.len = len;
+	memcpy(slot.data, pData, len);
+
+	slot.seq.store(idx + 1, memory_order_release);
+}
+
+void flightRecord(FlightEventType type, uint8_t idSrc, const void *pData, size_t len)
+{
+	const uint8_t *pBuf = (const uint8_t *)pData;
+	uint32_t timeUs = usMonotonic();
+	size_t lenChunk;
+
+	do
+	{
+		lenChunk = len < cSizeDataFlight ? len : cSizeDataFlight;
+
+		slotWrite(type, idSrc, timeUs, pBuf, lenChunk);
+
+		pBuf += lenChunk;
+		len -= lenChunk;
+	} while (len);
+}
+
+void flightRecord(FlightEventType type, uint8_t idSrc, uint32_t val)
+{
+	slotWrite(type, idSrc, usMonotonic(), (const uint8_t *)&val, sizeof(val));
+}
+
+uint32_t flightCntEvents()
+{
+	return idxFlightNext.load(memory_order_relaxed);
+}
+
+static char *strAppend(char *pBuf, char *pBufEnd, const char *pStr)
+{
+	for (; *pStr && pBuf < pBufEnd; ++pStr)
+		*pBuf++ = *pStr;
+
+	return pBuf;
+}
+
+static char *uintAppend(char *pBuf, char *pBufEnd, uint32_t val, size_t width = 0)
+{
+	char digits[10];
+	size_t len = 0;
+
+	do
+	{
+		digits[len++] = '0' + val % 10;
+		val /= 10;
+	} while (val);
+
+	for (; width > len && pBuf < pBufEnd; --width)
+		*pBuf++ = ' ';
+
+	while (len && pBuf < pBufEnd)
+		*pBuf++ = digits[--len];
+
+	return pBuf;
+}
+
+static char *hexAppend(char *pBuf, char *pBufEnd, uint8_t val)
+{
+	static const char *pHex = "0123456789ABCDEF";
+
+	if (pBufEnd - pBuf < 3)
+		return pBuf;
+
+	*pBuf++ = ' ';
+	*pBuf++ = pHex[val >> 4];
+	*pBuf++ = pHex[val & 0x0F];
+
+	return pBuf;
+}
+
+// <seq> <time [us]> t<source> <event> <payload>
+static size_t lineCreate(char *pBuf, char *pBufEnd, uint32_t seq, const FlightSlot &slot)
+{
+	char *pStart = pBuf;
+	uint32_t val = 0;
+
+	pBuf = uintAppend(pBuf, pBufEnd, seq, 10);
+	pBuf = strAppend(pBuf, pBufEnd, " ");
+	pBuf = uintAppend(pBuf, pBufEnd, slot.timeUs, 10);
+	pBuf = strAppend(pBuf, pBufEnd, " t");
+	pBuf = uintAppend(pBuf, pBufEnd, slot.idSrc);
+	pBuf = strAppend(pBuf, pBufEnd, " ");
+	pBuf = strAppend(pBuf, pBufEnd, FlightEventTypeString[slot.type]);
+
+	switch (slot.type)
+	{
+	case FlightCmd:
+
+		pBuf = strAppend(pBuf, pBufEnd, " '");
+		for (size_t i = 0; i < slot.len && pBuf < pBufEnd; ++i)
+			*pBuf++ = slot.data[i] >= 0x20 && slot.data[i] < 0x7F ? slot.data[i] : '.';
+		pBuf = strAppend(pBuf, pBufEnd, "'");
+
+		break;
+	case FlightState:
+	case FlightStateSwt:
+	case FlightFrameStart:
+	case FlightFrameEnd:
+	case FlightFrameCut:
+	case FlightFrameErr:
+
+		memcpy(&val, slot.data, sizeof(val));
+
+		if (val < cntNamesFlight[slot.type])
+		{
+			pBuf = strAppend(pBuf, pBufEnd, " ");
+			pBuf = strAppend(pBuf, pBufEnd, namesFlight[slot.type][val]);
+			break;
+		}
+
+		pBuf = hexAppend(pBuf, pBufEnd, val);
+
+		break;
+	case FlightUartRx:
+	case FlightUartTx:
+	default:
+
+		for (size_t i = 0; i < slot.len; ++i)
+			pBuf = hexAppend(pBuf, pBufEnd, slot.data[i]);
+
+		break;
+	}
+
+	pBuf = strAppend(pBuf, pBufEnd, "\n");
+
+	return pBuf - pStart;
+}
+
+/*
+ * Slots are read like a seqlock. A slot which is being
+ * overwritten during the dump is skipped
+ */
+size_t flightDump(int fd)
+{
+	uint32_t idxEnd = idxFlightNext.load(memory_order_acquire);
+	uint32_t idxStart = idxEnd > cNumSlotsFlight ? idxEnd - cNumSlotsFlight : 0;
+	char line[cSizeLineFlight];
+	FlightSlot slot;
+	uint32_t seqStart, seqEnd;
+	size_t cntDone = 0, len;
+	ssize_t res;
+
+	for (uint32_t idx = idxStart; idx != idxEnd; ++idx)
+	{
+		const FlightSlot &slotRing = slotsFlight[idx & (cNumSlotsFlight - 1)];
+
+		seqStart = slotRing.seq.load(memory_order_acquire);
+
+		slot.timeUs = slotRing.timeUs;
+		slot.type = slotRing.type;
+		slot.idSrc = slotRing.idSrc;
+		slot.len = slotRing.len;
+		memcpy(slot.data, slotRing.data, sizeof(slot.data));
+
+		atomic_thread_fence(memory_order_acquire);
+		seqEnd = slotRing.seq.load(memory_order_relaxed);
+
+		if (seqStart != idx + 1 || seqEnd != seqStart)
+			continue;
+
+		if (slot.type >= cNumFlightEventTypes || slot.len > cSizeDataFlight)
+			continue;
+
+		len = lineCreate(line, line + sizeof(line), seqStart, slot);
+
+		res = write(fd, line, len);
+		if (res < 0)
+			break;
+
+		++cntDone;
+	}
+
+	return cntDone;
+}
+
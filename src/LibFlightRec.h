@@ -0,0 +1,79 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIB_FLIGHT_REC_H
+#define LIB_FLIGHT_REC_H
+
+#include <cinttypes>
+#include <cstddef>
+
+/*
+ * Flight recorder for the single wire.
+ *
+ * Fixed-size ring of the most recent events, shared by
+ * all targets. Recording is lock-free and wait-free:
+ * One atomic increment claims a slot, which is then
+ * published with a sequence number. Old events are
+ * overwritten. Cheap enough to stay on in production.
+ *
+ * The dump only uses write(2) and can therefore be
+ * called from signal handlers.
+ */
+
+#define dForEach_FlightEvent(gen) \
+		gen(FlightUartRx) \
+		gen(FlightUartTx) \
+		gen(FlightFrameStart) \
+		gen(FlightFrameEnd) \
+		gen(FlightFrameCut) \
+		gen(FlightFrameErr) \
+		gen(FlightState) \
+		gen(FlightStateSwt) \
+		gen(FlightCmd) \
+
+#define dGenFlightEventEnum(s) s,
+enum FlightEventType
+{
+	dForEach_FlightEvent(dGenFlightEventEnum)
+	cNumFlightEventTypes
+};
+
+// Each target gets its own source ID
+uint8_t flightSourceCreate();
+
+// Optional. Used to print state names in dumps
+void flightNamesSet(FlightEventType type, const char * const *pNames, size_t cntNames);
+
+// Split into several events if necessary
+void flightRecord(FlightEventType type, uint8_t idSrc, const void *pData, size_t len);
+void flightRecord(FlightEventType type, uint8_t idSrc, uint32_t val);
+
+uint32_t flightCntEvents();
+
+// Async-signal-safe. Returns the number of events written
+size_t flightDump(int fd);
+
+#endif
+
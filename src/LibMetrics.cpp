@@ -0,0 +1,104 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LibMetrics.h"
+
+using namespace std;
+
+void metricAdd(MetricFamilies &families,
+			const char *pName,
+			MetricType type,
+			const char *pHelp,
+			const string &labels,
+			uint64_t val)
+{
+	MetricFamily &family = families[pName];
+
+	if (!family.help.size())
+	{
+		family.type = type;
+		family.help = pHelp;
+	}
+
+	family.samples += pName;
+
+	if (labels.size())
+	{
+		family.samples += "{";
+		family.samples += labels;
+		family.samples += "}";
+	}
+
+	family.samples += " ";
+	family.samples += to_string(val);
+	family.samples += "\n";
+}
+
+void metricsRender(const MetricFamilies &families, string &str)
+{
+	MetricFamilies::const_iterator iter;
+
+	iter = families.begin();
+	for (; iter != families.end(); ++iter)
+	{
+		const MetricFamily &family = iter->second;
+
+		str += "# HELP ";
+		str += iter->first;
+		str += " ";
+		str += family.help;
+		str += "\n";
+
+		str += "# TYPE ";
+		str += iter->first;
+		str += family.type == MetricCounter ? " counter\n" : " gauge\n";
+
+		str += family.samples;
+	}
+}
+
+string labelEscape(const string &val)
+{
+	string str;
+
+	str.reserve(val.size());
+
+	for (size_t i = 0; i < val.size(); ++i)
+	{
+		if (val[i] == '\\' || val[i] == '"')
+			str.push_back('\\');
+
+		if (val[i] == '\n')
+		{
+			str += "\\n";
+			continue;
+		}
+
+		str.push_back(val[i]);
+	}
+
+	return str;
+}
+
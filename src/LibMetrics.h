@@ -0,0 +1,86 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIB_METRICS_H
+#define LIB_METRICS_H
+
+#include <cinttypes>
+#include <string>
+#include <map>
+#include <atomic>
+
+/*
+ * Metrics in the Prometheus text exposition format.
+ *
+ * Counters are updated on the hot paths with relaxed
+ * atomics. Samples of all targets are collected per
+ * family first, because the format requires the
+ * samples of one metric to be grouped together.
+ *
+ * Literature
+ * - https://prometheus.io/docs/instrumenting/exposition_formats/
+ */
+
+typedef std::atomic<uint64_t> Counter;
+
+inline void cntInc(Counter &cnt, uint64_t val = 1)
+{
+	cnt.fetch_add(val, std::memory_order_relaxed);
+}
+
+inline uint64_t cntGet(const Counter &cnt)
+{
+	return cnt.load(std::memory_order_relaxed);
+}
+
+enum MetricType
+{
+	MetricCounter = 0,
+	MetricGauge,
+};
+
+struct MetricFamily
+{
+	MetricType type;
+	std::string help;
+	std::string samples;
+};
+
+typedef std::map<std::string, MetricFamily> MetricFamilies;
+
+// Labels without braces. Example: device="/dev/ttyACM0"
+void metricAdd(MetricFamilies &families,
+			const char *pName,
+			MetricType type,
+			const char *pHelp,
+			const std::string &labels,
+			uint64_t val);
+
+void metricsRender(const MetricFamilies &families, std::string &str);
+
+std::string labelEscape(const std::string &val);
+
+#endif
+
@@ -0,0 +1,163 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+
+#include "LibProfiling.h"
+#include "Processing.h"
+
+using namespace std;
+using namespace chrono;
+
+static size_t bucketIdx(uint64_t val);
+static uint64_t bucketValue(size_t idx);
+
+uint64_t usMonotonic()
+{
+	return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+Histogram::Histogram()
+	: cnt(0)
+	, total(0)
+	, valMax(0)
+{
+	for (size_t i = 0; i < cNumBucketsHist; ++i)
+		buckets[i].store(0, memory_order_relaxed);
+}
+
+void Histogram::add(uint64_t val)
+{
+	buckets[bucketIdx(val)].fetch_add(1, memory_order_relaxed);
+	cnt.fetch_add(1, memory_order_relaxed);
+	total.fetch_add(val, memory_order_relaxed);
+
+	// Single writer. No CAS needed
+	if (val > valMax.load(memory_order_relaxed))
+		valMax.store(val, memory_order_relaxed);
+}
+
+void Histogram::reset()
+{
+	for (size_t i = 0; i < cNumBucketsHist; ++i)
+		buckets[i].store(0, memory_order_relaxed);
+
+	cnt.store(0, memory_order_relaxed);
+	total.store(0, memory_order_relaxed);
+	valMax.store(0, memory_order_relaxed);
+}
+
+uint64_t Histogram::count() const
+{
+	return cnt.load(memory_order_relaxed);
+}
+
+uint64_t Histogram::sum() const
+{
+	return total.load(memory_order_relaxed);
+}
+
+uint64_t Histogram::max() const
+{
+	return valMax.load(memory_order_relaxed);
+}
+
+uint64_t Histogram::percentile(uint32_t perMille) const
+{
+	uint64_t numTotal = count();
+
+	if (!numTotal)
+		return 0;
+
+	uint64_t numReq = (numTotal * perMille + 999) / 1000;
+	uint64_t numDone = 0;
+
+	for (size_t i = 0; i < cNumBucketsHist; ++i)
+	{
+		numDone += buckets[i].load(memory_order_relaxed);
+
+		if (numDone < numReq)
+			continue;
+
+		return PMIN(bucketValue(i), max());
+	}
+
+	return max();
+}
+
+void histogramInfoPrint(char *&pBuf, char *pBufEnd,
+			const char *pName, const Histogram &hist)
+{
+	uint64_t cnt = hist.count();
+	uint64_t avg = cnt ? hist.sum() / cnt : 0;
+
+	dInfo("%s [us]\n", pName);
+	dInfo("  Count\t\t\t%llu\n", (unsigned long long)cnt);
+	dInfo("  Total\t\t\t%llu\n", (unsigned long long)hist.sum());
+	dInfo("  Avg / p50 / p99 / Max\t%llu / %llu / %llu / %llu\n",
+			(unsigned long long)avg,
+			(unsigned long long)hist.percentile(500),
+			(unsigned long long)hist.percentile(990),
+			(unsigned long long)hist.max());
+}
+
+/* static functions */
+
+size_t bucketIdx(uint64_t val)
+{
+	if (val < cNumSubBucketsHist)
+		return val;
+
+	size_t msb = 0;
+	uint64_t tmp = val;
+
+	for (size_t shift = 32; shift; shift >>= 1)
+	{
+		if (tmp < ((uint64_t)1 << shift))
+			continue;
+
+		tmp >>= shift;
+		msb += shift;
+	}
+
+	// msb >= 3
+	size_t sub = (val >> (msb - 3)) & (cNumSubBucketsHist - 1);
+	size_t idx = (msb - 2) * cNumSubBucketsHist + sub;
+
+	return PMIN(idx, cNumBucketsHist - 1);
+}
+
+// Upper bound of values stored in bucket
+uint64_t bucketValue(size_t idx)
+{
+	if (idx < cNumSubBucketsHist)
+		return idx;
+
+	size_t msb = idx / cNumSubBucketsHist + 2;
+	uint64_t sub = idx % cNumSubBucketsHist;
+
+	return ((cNumSubBucketsHist + sub + 1) << (msb - 3)) - 1;
+}
+
@@ -0,0 +1,126 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIB_PROFILING_H
+#define LIB_PROFILING_H
+
+#include <cstddef>
+#include <cinttypes>
+#include <atomic>
+
+#ifndef CONFIG_APP_HAVE_PROFILING
+#define CONFIG_APP_HAVE_PROFILING 0
+#endif
+
+// Monotonic clock in [us]
+uint64_t usMonotonic();
+
+/*
+ * HDR style histogram. Powers of two are split into
+ * eight linear sub-buckets => Relative error < 12.5%.
+ * Values up to 2^40 are distinguished.
+ *
+ * Writer and reader may live on different threads.
+ * Relaxed atomics are enough for statistics
+ */
+const size_t cNumSubBucketsHist = 8;
+const size_t cNumBucketsHist = 40 * cNumSubBucketsHist;
+
+struct Histogram
+{
+	Histogram();
+
+	void add(uint64_t val);
+	void reset();
+
+	uint64_t count() const;
+	uint64_t sum() const;
+	uint64_t max() const;
+	uint64_t percentile(uint32_t perMille) const;
+
+	std::atomic<uint32_t> buckets[cNumBucketsHist];
+	std::atomic<uint64_t> cnt;
+	std::atomic<uint64_t> total;
+	std::atomic<uint64_t> valMax;
+
+private:
+
+	Histogram(const Histogram &) = delete;
+	Histogram &operator=(const Histogram &) = delete;
+
+};
+
+// Used by processInfo(). Values in [us]
+void histogramInfoPrint(char *&pBuf, char *pBufEnd,
+			const char *pName, const Histogram &hist);
+
+/*
+ * Tick profiler. Measures the wall time of each
+ * process() call with the scope object below.
+ *
+ * Usage
+ *   Header:  #if CONFIG_APP_HAVE_PROFILING
+ *            ProfileTick mProfTick;
+ *            #endif
+ *   Process: dProfileTick(mProfTick);
+ *   Info:    dProfileInfo(mProfTick);
+ */
+class ProfileScope
+{
+
+public:
+
+	ProfileScope(Histogram &hist)
+		: mHist(hist)
+		, mStartUs(usMonotonic())
+	{}
+
+	~ProfileScope()
+	{
+		mHist.add(usMonotonic() - mStartUs);
+	}
+
+private:
+
+	ProfileScope(const ProfileScope &) = delete;
+	ProfileScope &operator=(const ProfileScope &) = delete;
+
+	Histogram &mHist;
+	uint64_t mStartUs;
+
+};
+
+typedef Histogram ProfileTick;
+
+#if CONFIG_APP_HAVE_PROFILING
+#define dProfileTick(p)		ProfileScope profScope(p)
+#define dProfileInfo(p)		histogramInfoPrint(pBuf, pBufEnd, "Tick", p)
+#else
+#define dProfileTick(p)
+#define dProfileInfo(p)
+#endif
+
+#endif
+
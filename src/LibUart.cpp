@@ -28,6 +28,10 @@
 #include <termios.h>
 #include <unistd.h>
 #endif
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <poll.h>
+#endif
 #if defined(_WIN32)
 #include <winsock2.h>
 #endif
@@ -36,26 +40,20 @@
 
 using namespace std;
 
-uint8_t uartVirtualMode = 0; // swart
-uint8_t uartVirtual = 0;
-uint8_t uartVirtualMounted = 0;
-
-static uint8_t bufVirtual[31];
-static size_t lenWritten = 0;
-static uint8_t *pBufVirt = bufVirtual;
-
 /*
  * Literature
  * - https://man7.org/linux/man-pages/man3/tcgetattr.3p.html
  * - https://man7.org/linux/man-pages/man2/write.2.html
  * - https://man7.org/linux/man-pages/man2/read.2.html
  */
-Success devUartInit(const string &deviceUart, RefDeviceUart &refUart)
+Success devUartInit(const string &deviceUart, DeviceUart &dev)
 {
+	RefDeviceUart &refUart = dev.ref;
+
 	refUart = RefDeviceUartInvalid;
 
-	if (uartVirtual)
-		return uartVirtualMounted ? Positive : Pending;
+	if (dev.virtualEnabled)
+		return dev.virtualMounted ? Positive : Pending;
 
 	Success success;
 
@@ -112,50 +110,170 @@ Success devUartInit(const string &deviceUart, RefDeviceUart &refUart)
 errInit:
 #if defined(__unix__)
 	close(refUart);
+	refUart = RefDeviceUartInvalid;
 #endif
 	return success;
 }
 
-void devUartDeInit(RefDeviceUart &refUart)
+void devUartDeInit(DeviceUart &dev)
 {
-	if (refUart == RefDeviceUartInvalid)
+	if (dev.ref == RefDeviceUartInvalid)
 		return;
 
 #if defined(__unix__)
-	close(refUart);
+	close(dev.ref);
+#endif
+	dev.ref = RefDeviceUartInvalid;
+}
+
+/*
+ * Literature
+ * - https://man7.org/linux/man-pages/man7/inotify.7.html
+ * - https://man7.org/linux/man-pages/man2/poll.2.html
+ */
+bool devUartWatchInit(const string &deviceUart, DeviceUart &dev)
+{
+#if defined(__linux__)
+	if (dev.fdWatch >= 0)
+		return true;
+
+	size_t idxSlash = deviceUart.find_last_of('/');
+	string dir = ".";
+
+	if (idxSlash == 0)
+		dir = "/";
+	else
+	if (idxSlash != string::npos)
+		dir = deviceUart.substr(0, idxSlash);
+
+	dev.fdWatch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (dev.fdWatch < 0)
+		return false;
+
+	// udev creates the node first and sets the permissions afterwards
+	int res = inotify_add_watch(dev.fdWatch, dir.c_str(),
+					IN_CREATE | IN_ATTRIB | IN_MOVED_TO);
+	if (res < 0)
+	{
+		devUartWatchDeInit(dev);
+		return false;
+	}
+
+	return true;
+#else
+	(void)deviceUart;
+	(void)dev;
+
+	return false;
 #endif
-	refUart = RefDeviceUartInvalid;
 }
 
-ssize_t uartSend(RefDeviceUart refUart, const void *pBuf, size_t lenReq)
+bool devUartAppeared(const string &deviceUart, DeviceUart &dev, uint32_t timeoutMs)
+{
+#if defined(__linux__)
+	if (dev.fdWatch < 0)
+		return true;
+
+	if (timeoutMs)
+	{
+		struct pollfd pfd;
+
+		pfd.fd = dev.fdWatch;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+
+		if (poll(&pfd, 1, timeoutMs) <= 0)
+			return false;
+	}
+
+	char buf[1024];
+	struct inotify_event event;
+	const char *pName = deviceUart.c_str();
+	size_t idxSlash = deviceUart.find_last_of('/');
+	bool appeared = false;
+	ssize_t lenDone;
+	char *pBuf;
+
+	if (idxSlash != string::npos)
+		pName += idxSlash + 1;
+
+	while (1)
+	{
+		lenDone = read(dev.fdWatch, buf, sizeof(buf));
+		if (lenDone <= 0)
+			break;
+
+		pBuf = buf;
+		while (pBuf < buf + lenDone)
+		{
+			// Copy avoids unaligned access on strict targets
+			memcpy(&event, pBuf, sizeof(event));
+			pBuf += sizeof(event);
+
+			if (!event.len)
+				continue;
+
+			pBuf += event.len;
+
+			if (strcmp(pBuf - event.len, pName))
+				continue;
+
+			appeared = true;
+		}
+	}
+
+	return appeared;
+#else
+	(void)deviceUart;
+	(void)dev;
+	(void)timeoutMs;
+
+	return true;
+#endif
+}
+
+void devUartWatchDeInit(DeviceUart &dev)
+{
+	if (dev.fdWatch < 0)
+		return;
+
+#if defined(__unix__)
+	close(dev.fdWatch);
+#endif
+	dev.fdWatch = -1;
+}
+
+ssize_t uartSend(DeviceUart &dev, const void *pBuf, size_t lenReq)
 {
 	if (!lenReq)
 		return -1;
 
-	if (uartVirtual)
+	if (dev.virtualEnabled)
 	{
-		if (!uartVirtualMounted)
+		if (!dev.virtualMounted)
 			return -1;
 
-		size_t lenAttemted = PMIN(lenReq, sizeof(bufVirtual));
-		*bufVirtual = 0;
+		size_t lenAttemted = PMIN(lenReq, sizeof(dev.bufVirtual));
+		*dev.bufVirtual = 0;
 
-		if (uartVirtualMode) // mode = uart: TX not connected to RX
+		if (dev.virtualMode) // mode = uart: TX not connected to RX
 			return lenAttemted;
 
-		lenWritten = lenAttemted;
-		pBufVirt = bufVirtual;
+		dev.lenWritten = lenAttemted;
+		dev.idxVirtual = 0;
 
-		memcpy(pBufVirt, pBuf, lenWritten);
+		memcpy(dev.bufVirtual, pBuf, dev.lenWritten);
 
-		return lenWritten;
+		return dev.lenWritten;
 	}
 
-	if (refUart == RefDeviceUartInvalid)
+	if (dev.ref == RefDeviceUartInvalid)
 		return -1;
 
+	ssize_t lenWritten = -1;
+
 #if defined(__unix__)
-	lenWritten = write(refUart, pBuf, lenReq);
+	lenWritten = write(dev.ref, pBuf, lenReq);
 #else
 	(void)pBuf;
 	(void)lenReq;
@@ -163,9 +281,9 @@ ssize_t uartSend(RefDeviceUart refUart, const void *pBuf, size_t lenReq)
 	return lenWritten;
 }
 
-ssize_t uartSend(RefDeviceUart refUart, uint8_t ch)
+ssize_t uartSend(DeviceUart &dev, uint8_t ch)
 {
-	return uartSend(refUart, &ch, sizeof(ch));
+	return uartSend(dev, &ch, sizeof(ch));
 }
 
 static int errGet()
@@ -177,37 +295,37 @@ static int errGet()
 #endif
 }
 
-ssize_t uartRead(RefDeviceUart refUart, void *pBuf, size_t lenReq)
+ssize_t uartRead(DeviceUart &dev, void *pBuf, size_t lenReq)
 {
 	if (!lenReq)
 		return -1;
 
-	if (uartVirtual)
+	if (dev.virtualEnabled)
 	{
-		if (!uartVirtualMounted)
+		if (!dev.virtualMounted)
 			return -1;
 
 		size_t lenRead;
 
-		lenRead = PMIN(lenReq, lenWritten);
+		lenRead = PMIN(lenReq, dev.lenWritten);
 		if (!lenRead)
 			return 0;
 
-		memcpy(pBuf, pBufVirt, lenRead);
+		memcpy(pBuf, dev.bufVirtual + dev.idxVirtual, lenRead);
 
-		lenWritten -= lenRead;
-		pBufVirt += lenRead;
+		dev.lenWritten -= lenRead;
+		dev.idxVirtual += lenRead;
 
 		return lenRead;
 	}
 
-	if (refUart == RefDeviceUartInvalid)
+	if (dev.ref == RefDeviceUartInvalid)
 		return -1;
 
 	ssize_t lenRead;
 
 #if defined(__unix__)
-	lenRead = read(refUart, pBuf, lenReq);
+	lenRead = read(dev.ref, pBuf, lenReq);
 	if (!lenRead)
 		return -2;
 #else
@@ -235,18 +353,16 @@ ssize_t uartRead(RefDeviceUart refUart, void *pBuf, size_t lenReq)
 	return lenRead;
 }
 
-ssize_t uartVirtRcv(RefDeviceUart refUart, const void *pBuf, size_t lenReq)
+ssize_t uartVirtRcv(DeviceUart &dev, const void *pBuf, size_t lenReq)
 {
-	(void)refUart;
-
-	if (!uartVirtual)
+	if (!dev.virtualEnabled)
 		return -1;
 
-	lenWritten = PMIN(lenReq, sizeof(bufVirtual));
-	pBufVirt = bufVirtual;
+	dev.lenWritten = PMIN(lenReq, sizeof(dev.bufVirtual));
+	dev.idxVirtual = 0;
 
-	memcpy(pBufVirt, pBuf, lenWritten);
+	memcpy(dev.bufVirtual, pBuf, dev.lenWritten);
 
-	return lenWritten;
+	return dev.lenWritten;
 }
 
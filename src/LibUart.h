@@ -28,6 +28,7 @@
 
 #include <cinttypes>
 #include <string>
+#include <atomic>
 #if defined(_WIN32)
 #include <winsock2.h>
 #include <windows.h>
@@ -43,17 +44,53 @@ typedef int RefDeviceUart;
 #define RefDeviceUartInvalid -1
 #endif
 
-extern uint8_t uartVirtualMode;
-extern uint8_t uartVirtual;
-extern uint8_t uartVirtualMounted;
+/*
+ * State of a single UART device. Every target
+ * served by the gateway owns one of these
+ */
+struct DeviceUart
+{
+	DeviceUart()
+		: ref(RefDeviceUartInvalid)
+		, fdWatch(-1)
+		, virtualMode(0) // swart
+		, virtualEnabled(0)
+		, virtualMounted(0)
+		, virtualTimeout(0)
+		, lenWritten(0)
+		, idxVirtual(0)
+	{
+		bufVirtual[0] = 0;
+	}
+
+	RefDeviceUart ref;
+	int fdWatch;
+	// Toggled by debug commands on another thread
+	std::atomic<uint8_t> virtualMode;
+	std::atomic<uint8_t> virtualEnabled;
+	std::atomic<uint8_t> virtualMounted;
+	std::atomic<uint8_t> virtualTimeout;
+	uint8_t bufVirtual[31];
+	size_t lenWritten;
+	size_t idxVirtual;
+};
 
-Success devUartInit(const std::string &deviceUart, RefDeviceUart &refUart);
-void devUartDeInit(RefDeviceUart &refUart);
+Success devUartInit(const std::string &deviceUart, DeviceUart &dev);
+void devUartDeInit(DeviceUart &dev);
+
+/*
+ * Hotplug detection. Instead of polling with open()
+ * the directory of the device node is watched.
+ * Only available on Linux. Returns false otherwise
+ */
+bool devUartWatchInit(const std::string &deviceUart, DeviceUart &dev);
+bool devUartAppeared(const std::string &deviceUart, DeviceUart &dev, uint32_t timeoutMs = 0);
+void devUartWatchDeInit(DeviceUart &dev);
 
-ssize_t uartSend(RefDeviceUart refUart, const void *pBuf, size_t lenReq);
-ssize_t uartSend(RefDeviceUart refUart, uint8_t ch);
-ssize_t uartRead(RefDeviceUart refUart, void *pBuf, size_t lenReq);
-ssize_t uartVirtRcv(RefDeviceUart refUart, const void *pBuf, size_t lenReq);
+ssize_t uartSend(DeviceUart &dev, const void *pBuf, size_t lenReq);
+ssize_t uartSend(DeviceUart &dev, uint8_t ch);
+ssize_t uartRead(DeviceUart &dev, void *pBuf, size_t lenReq);
+ssize_t uartVirtRcv(DeviceUart &dev, const void *pBuf, size_t lenReq);
 
 #endif
 
@@ -0,0 +1,213 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "LibWakeup.h"
+#include "LibTime.h"
+
+using namespace std;
+
+static atomic<bool> deadlineValid(false);
+static atomic<uint32_t> deadlineNextMs(0);
+
+#if defined(__linux__)
+static int fdEpoll = -1;
+static int fdTimer = -1;
+static int fdNotify = -1;
+#endif
+
+/*
+ * Literature
+ * - https://man7.org/linux/man-pages/man7/epoll.7.html
+ * - https://man7.org/linux/man-pages/man2/timerfd_create.2.html
+ * - https://man7.org/linux/man-pages/man2/eventfd.2.html
+ */
+bool wakeupInit()
+{
+#if defined(__linux__)
+	fdEpoll = epoll_create1(EPOLL_CLOEXEC);
+	if (fdEpoll < 0)
+		goto errInit;
+
+	fdTimer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (fdTimer < 0)
+		goto errInit;
+
+	fdNotify = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (fdNotify < 0)
+		goto errInit;
+
+	wakeupFdAdd(fdTimer);
+	wakeupFdAdd(fdNotify);
+
+	return true;
+
+errInit:
+	wakeupDeInit();
+	return false;
+#else
+	return true;
+#endif
+}
+
+void wakeupDeInit()
+{
+#if defined(__linux__)
+	if (fdNotify >= 0)
+		close(fdNotify);
+	fdNotify = -1;
+
+	if (fdTimer >= 0)
+		close(fdTimer);
+	fdTimer = -1;
+
+	if (fdEpoll >= 0)
+		close(fdEpoll);
+	fdEpoll = -1;
+#endif
+}
+
+void wakeupDeadlineSet(uint32_t deadlineMs)
+{
+	uint32_t deadlineOld = deadlineNextMs.load(memory_order_relaxed);
+
+	while (deadlineValid.load(memory_order_relaxed))
+	{
+		// Wrap-around safe comparison
+		if ((int32_t)(deadlineMs - deadlineOld) >= 0)
+			return;
+
+		if (deadlineNextMs.compare_exchange_weak(deadlineOld, deadlineMs))
+			return;
+	}
+
+	deadlineNextMs.store(deadlineMs);
+	deadlineValid.store(true);
+}
+
+void wakeupFdAdd(int fd)
+{
+#if defined(__linux__)
+	if (fdEpoll < 0 || fd < 0)
+		return;
+
+	struct epoll_event ev;
+
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+
+	(void)epoll_ctl(fdEpoll, EPOLL_CTL_ADD, fd, &ev);
+#else
+	(void)fd;
+#endif
+}
+
+void wakeupFdRemove(int fd)
+{
+#if defined(__linux__)
+	if (fdEpoll < 0 || fd < 0)
+		return;
+
+	(void)epoll_ctl(fdEpoll, EPOLL_CTL_DEL, fd, NULL);
+#else
+	(void)fd;
+#endif
+}
+
+void wakeupNotify()
+{
+#if defined(__linux__)
+	if (fdNotify < 0)
+		return;
+
+	uint64_t val = 1;
+	ssize_t res = write(fdNotify, &val, sizeof(val));
+	(void)res;
+#endif
+}
+
+void wakeupWait(uint32_t waitMaxMs)
+{
+	uint32_t curTimeMs = millis();
+	uint32_t waitMs = waitMaxMs;
+	int32_t diffMs;
+
+	if (deadlineValid.exchange(false))
+	{
+		diffMs = (int32_t)(deadlineNextMs.load() - curTimeMs);
+
+		if (diffMs <= 0)
+			return;
+
+		if ((uint32_t)diffMs < waitMs)
+			waitMs = diffMs;
+	}
+
+	if (!waitMs)
+		return;
+
+#if defined(__linux__)
+	if (fdEpoll >= 0)
+	{
+		struct itimerspec ts;
+		struct epoll_event events[16];
+		uint64_t val;
+		ssize_t res;
+		int numEvents;
+
+		ts.it_interval.tv_sec = 0;
+		ts.it_interval.tv_nsec = 0;
+		ts.it_value.tv_sec = waitMs / 1000;
+		ts.it_value.tv_nsec = (waitMs % 1000) * 1000000L;
+
+		(void)timerfd_settime(fdTimer, 0, &ts, NULL);
+
+		numEvents = epoll_wait(fdEpoll, events, 16, -1);
+
+		for (int i = 0; i < numEvents; ++i)
+		{
+			if (events[i].data.fd != fdTimer &&
+					events[i].data.fd != fdNotify)
+				continue;
+
+			res = read(events[i].data.fd, &val, sizeof(val));
+			(void)res;
+		}
+
+		return;
+	}
+#endif
+	this_thread::sleep_for(chrono::milliseconds(waitMs));
+}
+
@@ -0,0 +1,60 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIB_WAKEUP_H
+#define LIB_WAKEUP_H
+
+#include <cinttypes>
+
+/*
+ * Wakeup handling of the main loop.
+ *
+ * Processes report the next point in time they need
+ * to be ticked (in millis()) and the file descriptors
+ * they are waiting on. The main loop then blocks until
+ * the earliest deadline, until one of the descriptors
+ * becomes readable or until another thread rings the
+ * doorbell with wakeupNotify().
+ *
+ * Linux: epoll + timerfd + eventfd
+ * Others: Sleep until deadline
+ */
+
+bool wakeupInit();
+void wakeupDeInit();
+
+// Thread safe. Earliest deadline wins. Reset after each wait
+void wakeupDeadlineSet(uint32_t deadlineMs);
+
+void wakeupFdAdd(int fd);
+void wakeupFdRemove(int fd);
+
+// Thread and async-signal safe
+void wakeupNotify();
+
+void wakeupWait(uint32_t waitMaxMs);
+
+#endif
+
@@ -0,0 +1,287 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "MetricsServing.h"
+#include "LibMetrics.h"
+#include "LibWakeup.h"
+#include "LibTime.h"
+
+#define dForEach_ProcState(gen) \
+		gen(StStart) \
+		gen(StMain) \
+
+#define dGenProcStateEnum(s) s,
+dProcessStateEnum(ProcState);
+
+#if 1
+#define dGenProcStateString(s) #s,
+dProcessStateStr(ProcState);
+#endif
+
+using namespace std;
+
+typedef list<MetricsScrape>::iterator ScrapeIter;
+typedef list<GwMsgDispatching *>::const_iterator AppConstIter;
+
+const uint32_t cTimeoutRequestMs = 2000;
+const uint32_t cTimeoutResponseMs = 10000;
+const uint32_t cDelaySendRetryMs = 5;
+const uint16_t cNumScrapesMax = 4;
+
+MetricsServing::MetricsServing(uint16_t port, const list<GwMsgDispatching *> *pListApps)
+	: Processing("MetricsServing")
+	, mPort(port)
+	, mpListApps(pListApps)
+	, mpLst(NULL)
+	, mListScrapes()
+	, mCntScrapes(0)
+	, mCntTimeouts(0)
+#if CONFIG_APP_HAVE_PROFILING
+	, mProfTick()
+#endif
+#if CONFIG_APP_HAVE_ALLOC_TRACKING
+	, mAllocTick()
+#endif
+{
+	mState = StStart;
+}
+
+/* member functions */
+
+Success MetricsServing::process()
+{
+	dProfileTick(mProfTick);
+	dAllocTick(mAllocTick);
+#if 0
+	dStateTrace;
+#endif
+	switch (mState)
+	{
+	case StStart:
+
+		if (!mpListApps)
+			return procErrLog(-1, "list of targets not set");
+
+		mpLst = TcpListening::create();
+		if (!mpLst)
+			return procErrLog(-1, "could not create process");
+
+		mpLst->portSet(mPort);
+		mpLst->maxConnSet(cNumScrapesMax);
+
+		mpLst->procTreeDisplaySet(false);
+		start(mpLst);
+
+		mState = StMain;
+
+		break;
+	case StMain:
+
+		scrapesAccept();
+		scrapesServe();
+
+		break;
+	default:
+		break;
+	}
+
+	return Pending;
+}
+
+void MetricsServing::scrapesAccept()
+{
+	PipeEntry<SOCKET> peerFd;
+	MetricsScrape scrape;
+
+	while (1)
+	{
+		if (mpLst->ppPeerFd.get(peerFd) < 1)
+			break;
+
+		scrape.pTrans = TcpTransfering::create(peerFd.particle);
+		if (!scrape.pTrans)
+		{
+			procErrLog(-1, "could not create process");
+			continue;
+		}
+
+		scrape.pTrans->procTreeDisplaySet(false);
+		start(scrape.pTrans);
+
+		scrape.fd = peerFd.particle;
+		scrape.startMs = millis();
+		scrape.resp.clear();
+		scrape.idxSent = 0;
+		scrape.responded = false;
+		scrape.sent = false;
+
+		wakeupFdAdd(scrape.fd);
+		mListScrapes.push_back(scrape);
+	}
+}
+
+void MetricsServing::scrapesServe()
+{
+	uint32_t curTimeMs = millis();
+	ScrapeIter iter;
+	TcpTransfering *pTrans;
+	uint32_t timeoutMs;
+	bool removeReq;
+
+	iter = mListScrapes.begin();
+	while (iter != mListScrapes.end())
+	{
+		pTrans = iter->pTrans;
+		removeReq = pTrans->success() != Pending;
+
+		// Transfer got one more tick to drain
+		if (iter->sent)
+			removeReq = true;
+
+		if (!removeReq && !iter->responded && requestReceived(pTrans))
+		{
+			responseCreate(iter->resp);
+			++mCntScrapes;
+
+			iter->responded = true;
+			iter->startMs = curTimeMs;
+		}
+
+		if (!removeReq && iter->responded)
+			removeReq = !responseSend(*iter);
+
+		timeoutMs = iter->responded ? cTimeoutResponseMs : cTimeoutRequestMs;
+
+		if (!removeReq && curTimeMs - iter->startMs > timeoutMs)
+		{
+			++mCntTimeouts;
+			removeReq = true;
+		}
+
+		if (!removeReq)
+		{
+			if (iter->responded)
+				wakeupDeadlineSet(curTimeMs + cDelaySendRetryMs);
+			else
+				wakeupDeadlineSet(iter->startMs + timeoutMs + 1);
+
+			++iter;
+			continue;
+		}
+
+		wakeupFdRemove(iter->fd);
+		repel(pTrans);
+
+		iter = mListScrapes.erase(iter);
+	}
+}
+
+/*
+ * The request itself is irrelevant. Every path
+ * returns the metrics, like most exporters do.
+ */
+bool MetricsServing::requestReceived(TcpTransfering *pTrans)
+{
+	char buf[256];
+	ssize_t lenDone;
+	bool received = false;
+
+	while (1)
+	{
+		lenDone = pTrans->read(buf, sizeof(buf));
+		if (lenDone <= 0)
+			break;
+
+		received = true;
+	}
+
+	return received;
+}
+
+void MetricsServing::responseCreate(string &msg)
+{
+	MetricFamilies families;
+	AppConstIter iter;
+	string body;
+
+	iter = mpListApps->begin();
+	for (; iter != mpListApps->end(); ++iter)
+		(*iter)->metricsAdd(families);
+
+	metricAdd(families, "codeorb_scrapes_total", MetricCounter,
+			"Metrics requests answered", "", mCntScrapes + 1);
+
+	metricsRender(families, body);
+
+	msg.reserve(body.size() + 128);
+
+	msg += "HTTP/1.0 200 OK\r\n";
+	msg += "Content-Type: text/plain; version=0.0.4\r\n";
+	msg += "Content-Length: " + to_string(body.size()) + "\r\n";
+	msg += "Connection: close\r\n";
+	msg += "\r\n";
+	msg += body;
+}
+
+/*
+ * Large bodies don't fit into the socket buffer at
+ * once. The rest is sent on the following ticks.
+ * Returns false if the connection broke
+ */
+bool MetricsServing::responseSend(MetricsScrape &scrape)
+{
+	size_t lenReq = scrape.resp.size() - scrape.idxSent;
+	ssize_t lenDone;
+
+	if (!lenReq)
+		return true;
+
+	lenDone = scrape.pTrans->send(scrape.resp.data() + scrape.idxSent, lenReq);
+	if (lenDone < 0)
+		return false;
+
+	scrape.idxSent += lenDone;
+
+	if (scrape.idxSent >= scrape.resp.size())
+		scrape.sent = true;
+
+	return true;
+}
+
+void MetricsServing::processInfo(char *pBuf, char *pBufEnd)
+{
+#if 1
+	dInfo("State\t\t\t%s\n", ProcStateString[mState]);
+#endif
+	dInfo("Port\t\t\t%u\n", mPort);
+	dInfo("Connections\t\t%zu\n", mListScrapes.size());
+	dInfo("Scrapes\t\t\t%u\n", mCntScrapes);
+	dInfo("Timeouts\t\t%u\n", mCntTimeouts);
+	dProfileInfo(mProfTick);
+	dAllocInfo(mAllocTick);
+}
+
+/* static functions */
+
@@ -0,0 +1,113 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef METRICS_SERVING_H
+#define METRICS_SERVING_H
+
+#include <list>
+
+#include "Processing.h"
+#include "LibProfiling.h"
+#include "LibAllocTracking.h"
+#include "TcpListening.h"
+#include "TcpTransfering.h"
+#include "GwMsgDispatching.h"
+
+struct MetricsScrape
+{
+	TcpTransfering *pTrans;
+	SOCKET fd;
+	uint32_t startMs;
+	std::string resp;
+	size_t idxSent;
+	bool responded;
+	bool sent;
+};
+
+/*
+ * Minimal HTTP/1.0 endpoint for Prometheus. Every
+ * request is answered with the metrics of all
+ * targets and the connection is closed afterwards.
+ */
+class MetricsServing : public Processing
+{
+
+public:
+
+	static MetricsServing *create(uint16_t port, const std::list<GwMsgDispatching *> *pListApps)
+	{
+		return new dNoThrow MetricsServing(port, pListApps);
+	}
+
+protected:
+
+	MetricsServing(uint16_t port, const std::list<GwMsgDispatching *> *pListApps);
+	virtual ~MetricsServing() {}
+
+private:
+
+	MetricsServing() = delete;
+	MetricsServing(const MetricsServing &) = delete;
+	MetricsServing &operator=(const MetricsServing &) = delete;
+
+	/*
+	 * Naming of functions:  objectVerb()
+	 * Example:              peerAdd()
+	 */
+
+	/* member functions */
+	Success process();
+	void processInfo(char *pBuf, char *pBufEnd);
+
+	void scrapesAccept();
+	void scrapesServe();
+	bool requestReceived(TcpTransfering *pTrans);
+	void responseCreate(std::string &msg);
+	bool responseSend(MetricsScrape &scrape);
+
+	/* member variables */
+	uint16_t mPort;
+	const std::list<GwMsgDispatching *> *mpListApps;
+	TcpListening *mpLst;
+	std::list<MetricsScrape> mListScrapes;
+	uint32_t mCntScrapes;
+	uint32_t mCntTimeouts;
+
+#if CONFIG_APP_HAVE_PROFILING
+	ProfileTick mProfTick;
+#endif
+#if CONFIG_APP_HAVE_ALLOC_TRACKING
+	AllocStats mAllocTick;
+#endif
+	/* static functions */
+
+	/* static variables */
+
+	/* constants */
+
+};
+
+#endif
+
@@ -0,0 +1,379 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ProcHistory.h"
+
+using namespace std;
+
+const size_t cIntervalKeyframe = 64;
+const size_t cSizeHistMax = 4 << 20;
+
+static void linesSplit(const string &content, vector<string> &lines);
+static void linesJoin(const vector<string> &lines, string &content);
+static bool deltaApply(const string &data, vector<string> &lines);
+static void varintAppend(string &data, size_t val);
+static bool varintGet(const string &data, size_t &pos, size_t &val);
+
+ProcHistory::ProcHistory()
+	: mFrames()
+	, mLinesLast()
+	, mIdFirst(1)
+	, mSizeBytes(0)
+	, mCntSinceKey(0)
+	, mpFileSpill(NULL)
+	, mKeysSpill()
+	, mCntSpilled(0)
+{
+}
+
+ProcHistory::~ProcHistory()
+{
+	if (!mpFileSpill)
+		return;
+
+	// Keep everything
+	while (mFrames.size())
+		groupDrop();
+
+	fclose(mpFileSpill);
+	mpFileSpill = NULL;
+}
+
+bool ProcHistory::spillSet(const string &path)
+{
+	if (mpFileSpill)
+		fclose(mpFileSpill);
+
+	mKeysSpill.clear();
+
+	// Reading back needs '+'. Writes always go to the end
+	mpFileSpill = fopen(path.c_str(), "a+b");
+
+	return mpFileSpill != NULL;
+}
+
+void ProcHistory::add(const string &content, uint32_t timeMs)
+{
+	vector<string> lines;
+	FrameHist frame;
+
+	linesSplit(content, lines);
+
+	frame.timeMs = timeMs;
+	frame.keyframe = !mFrames.size() || mCntSinceKey >= cIntervalKeyframe;
+
+	if (frame.keyframe)
+	{
+		frame.data = content;
+		mCntSinceKey = 0;
+	}
+	else
+	{
+		deltaCreate(lines, frame.data);
+		++mCntSinceKey;
+	}
+
+	mSizeBytes += sizeof(frame) + frame.data.size();
+	mFrames.push_back(std::move(frame));
+	mLinesLast.swap(lines);
+
+	while (mSizeBytes > cSizeHistMax && mFrames.size() > 1)
+		groupDrop();
+}
+
+uint32_t ProcHistory::idFirst() const
+{
+	if (mKeysSpill.size())
+		return mKeysSpill.front().id;
+
+	return mFrames.size() ? mIdFirst : 0;
+}
+
+uint32_t ProcHistory::idLast() const
+{
+	return mFrames.size() ? mIdFirst + mFrames.size() - 1 : 0;
+}
+
+/*
+ * Costs one keyframe and at most cIntervalKeyframe
+ * deltas. Only done when a viewer scrubs
+ */
+bool ProcHistory::frameGet(uint32_t id, string &content, uint32_t &timeMs) const
+{
+	size_t idx, idxKey;
+	vector<string> lines;
+
+	if (id < mIdFirst)
+		return frameSpilledGet(id, content, timeMs);
+
+	if (!mFrames.size() || id > idLast())
+		return false;
+
+	idx = id - mIdFirst;
+
+	for (idxKey = idx; !mFrames[idxKey].keyframe; --idxKey)
+		;
+
+	linesSplit(mFrames[idxKey].data, lines);
+
+	for (size_t i = idxKey + 1; i <= idx; ++i)
+	{
+		if (!deltaApply(mFrames[i].data, lines))
+			return false;
+	}
+
+	linesJoin(lines, content);
+	timeMs = mFrames[idx].timeMs;
+
+	return true;
+}
+
+/*
+ * Same as from memory, but the group is read from
+ * the spill file. Starts at the last keyframe not
+ * after the requested frame
+ */
+bool ProcHistory::frameSpilledGet(uint32_t id, string &content, uint32_t &timeMs) const
+{
+	size_t idxLow = 0, idxHigh = mKeysSpill.size(), idxMid;
+	vector<string> lines;
+	FrameHist frame;
+	uint32_t idRec;
+
+	if (!mpFileSpill || !mKeysSpill.size() || id < mKeysSpill.front().id)
+		return false;
+
+	// Binary search. IDs of the keyframes are ascending
+	while (idxHigh - idxLow > 1)
+	{
+		idxMid = (idxLow + idxHigh) / 2;
+
+		if (mKeysSpill[idxMid].id <= id)
+			idxLow = idxMid;
+		else
+			idxHigh = idxMid;
+	}
+
+	const KeySpill &key = mKeysSpill[idxLow];
+
+	if (fflush(mpFileSpill) || fseek(mpFileSpill, key.offset, SEEK_SET))
+		return false;
+
+	if (!recordRead(idRec, frame) || idRec != key.id || !frame.keyframe)
+		return false;
+
+	linesSplit(frame.data, lines);
+
+	while (idRec < id)
+	{
+		if (!recordRead(idRec, frame) || frame.keyframe)
+			return false;
+
+		if (!deltaApply(frame.data, lines))
+			return false;
+	}
+
+	if (idRec != id)
+		return false;
+
+	linesJoin(lines, content);
+	timeMs = frame.timeMs;
+
+	return true;
+}
+
+bool ProcHistory::recordRead(uint32_t &id, FrameHist &frame) const
+{
+	uint8_t keyframe;
+	uint32_t len;
+
+	if (fread(&id, sizeof(id), 1, mpFileSpill) != 1 ||
+			fread(&frame.timeMs, sizeof(frame.timeMs), 1, mpFileSpill) != 1 ||
+			fread(&keyframe, sizeof(keyframe), 1, mpFileSpill) != 1 ||
+			fread(&len, sizeof(len), 1, mpFileSpill) != 1)
+		return false;
+
+	if (len > cSizeHistMax)
+		return false;
+
+	frame.keyframe = keyframe != 0;
+	frame.data.resize(len);
+
+	if (len && fread(&frame.data[0], 1, len, mpFileSpill) != len)
+		return false;
+
+	return true;
+}
+
+// Number of lines. Then index, length and text of each changed line
+void ProcHistory::deltaCreate(const vector<string> &lines, string &data) const
+{
+	data.clear();
+	varintAppend(data, lines.size());
+
+	for (size_t i = 0; i < lines.size(); ++i)
+	{
+		if (i < mLinesLast.size() && lines[i] == mLinesLast[i])
+			continue;
+
+		varintAppend(data, i);
+		varintAppend(data, lines[i].size());
+		data += lines[i];
+	}
+}
+
+// Deltas need their keyframe => Drop whole groups
+void ProcHistory::groupDrop()
+{
+	do
+	{
+		const FrameHist &frame = mFrames.front();
+
+		if (mpFileSpill)
+			frameSpill(mIdFirst, frame);
+
+		mSizeBytes -= sizeof(frame) + frame.data.size();
+		mFrames.pop_front();
+		++mIdFirst;
+	} while (mFrames.size() && !mFrames.front().keyframe);
+}
+
+void ProcHistory::frameSpill(uint32_t id, const FrameHist &frame)
+{
+	uint32_t len = frame.data.size();
+	uint8_t keyframe = frame.keyframe ? 1 : 0;
+	KeySpill key;
+
+	// Required between reading and writing
+	fseek(mpFileSpill, 0, SEEK_END);
+
+	if (frame.keyframe)
+	{
+		key.id = id;
+		key.offset = ftell(mpFileSpill);
+
+		if (key.offset >= 0)
+			mKeysSpill.push_back(key);
+	}
+
+	fwrite(&id, sizeof(id), 1, mpFileSpill);
+	fwrite(&frame.timeMs, sizeof(frame.timeMs), 1, mpFileSpill);
+	fwrite(&keyframe, sizeof(keyframe), 1, mpFileSpill);
+	fwrite(&len, sizeof(len), 1, mpFileSpill);
+	fwrite(frame.data.data(), 1, len, mpFileSpill);
+
+	++mCntSpilled;
+}
+
+/* static functions */
+
+// Exact inverse of the join in frameGet()
+void linesSplit(const string &content, vector<string> &lines)
+{
+	size_t posStart = 0, posLf;
+
+	lines.clear();
+
+	while (1)
+	{
+		posLf = content.find('\n', posStart);
+		if (posLf == string::npos)
+			break;
+
+		lines.push_back(content.substr(posStart, posLf - posStart));
+		posStart = posLf + 1;
+	}
+
+	lines.push_back(content.substr(posStart));
+}
+
+void linesJoin(const vector<string> &lines, string &content)
+{
+	content.clear();
+
+	for (size_t i = 0; i < lines.size(); ++i)
+	{
+		if (i)
+			content.push_back('\n');
+		content += lines[i];
+	}
+}
+
+bool deltaApply(const string &data, vector<string> &lines)
+{
+	size_t pos = 0, numLines, idxLine, len;
+
+	if (!varintGet(data, pos, numLines))
+		return false;
+
+	lines.resize(numLines);
+
+	while (pos < data.size())
+	{
+		if (!varintGet(data, pos, idxLine) || idxLine >= numLines)
+			return false;
+
+		if (!varintGet(data, pos, len) || pos + len > data.size())
+			return false;
+
+		lines[idxLine].assign(data, pos, len);
+		pos += len;
+	}
+
+	return true;
+}
+
+void varintAppend(string &data, size_t val)
+{
+	while (val >= 0x80)
+	{
+		data.push_back((char)(0x80 | (val & 0x7F)));
+		val >>= 7;
+	}
+
+	data.push_back((char)val);
+}
+
+bool varintGet(const string &data, size_t &pos, size_t &val)
+{
+	unsigned shift = 0;
+	uint8_t b;
+
+	val = 0;
+
+	while (pos < data.size() && shift < 64)
+	{
+		b = (uint8_t)data[pos++];
+		val |= (size_t)(b & 0x7F) << shift;
+
+		if (!(b & 0x80))
+			return true;
+
+		shift += 7;
+	}
+
+	return false;
+}
+
@@ -0,0 +1,112 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PROC_HISTORY_H
+#define PROC_HISTORY_H
+
+#include <cinttypes>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+
+/*
+ * Bounded history of process tree frames.
+ *
+ * Every cIntervalKeyframe-th frame is stored as is.
+ * All frames in between only store the lines which
+ * differ from their predecessor. The tree changes by
+ * a few lines per refresh => Hours fit in megabytes.
+ *
+ * Frames are referenced by IDs which increase by one
+ * per frame. When the ring is full, the oldest group
+ * of keyframe and deltas is dropped and optionally
+ * appended to a spill file. Spilled frames can still
+ * be fetched. Only the file offsets of their keyframes
+ * are kept in memory.
+ *
+ * Frames are stored as sent to the peers. Including
+ * the screen clear in front.
+ *
+ * Spill file records
+ * - u32 ID, u32 time [ms], u8 keyframe, u32 length, data
+ */
+class ProcHistory
+{
+
+public:
+
+	ProcHistory();
+	~ProcHistory();
+
+	bool spillSet(const std::string &path);
+	void add(const std::string &content, uint32_t timeMs);
+
+	// IDs of the oldest and newest frame. 0 if empty
+	uint32_t idFirst() const;
+	uint32_t idLast() const;
+	size_t size() const { return mFrames.size(); }
+	size_t sizeBytes() const { return mSizeBytes; }
+	uint32_t cntSpilled() const { return mCntSpilled; }
+
+	bool frameGet(uint32_t id, std::string &content, uint32_t &timeMs) const;
+
+private:
+
+	struct FrameHist
+	{
+		uint32_t timeMs;
+		bool keyframe;
+		std::string data;
+	};
+
+	struct KeySpill
+	{
+		uint32_t id;
+		long offset;
+	};
+
+	ProcHistory(const ProcHistory &) = delete;
+	ProcHistory &operator=(const ProcHistory &) = delete;
+
+	void deltaCreate(const std::vector<std::string> &lines, std::string &data) const;
+	void groupDrop();
+	void frameSpill(uint32_t id, const FrameHist &frame);
+	bool frameSpilledGet(uint32_t id, std::string &content, uint32_t &timeMs) const;
+	bool recordRead(uint32_t &id, FrameHist &frame) const;
+
+	std::deque<FrameHist> mFrames;
+	std::vector<std::string> mLinesLast;
+	uint32_t mIdFirst;
+	size_t mSizeBytes;
+	size_t mCntSinceKey;
+	FILE *mpFileSpill;
+	std::vector<KeySpill> mKeysSpill;
+	uint32_t mCntSpilled;
+
+};
+
+#endif
+
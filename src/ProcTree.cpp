@@ -0,0 +1,312 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+
+#include "ProcTree.h"
+
+using namespace std;
+
+static void ansiStrip(const char *pLine, size_t len, string &text);
+static void trim(string &str);
+
+ProcTree::ProcTree()
+	: mNodes()
+	, mNodesOld()
+	, mIdxOld()
+	, mStack()
+	, mCntSiblings()
+	, mLinesHead()
+	, mInfosNew()
+	, mIdxCur(cNodeProcNone)
+	, mStructChanged(false)
+	, mGen(0)
+	, mGenStructure(0)
+{
+}
+
+uint32_t ProcTree::update(const string &content)
+{
+	const char *pLine = content.data();
+	const char *pEnd = pLine + content.size();
+	const char *pLf;
+	size_t len;
+
+	++mGen;
+
+	mNodesOld.swap(mNodes);
+	mNodes.clear();
+
+	mIdxOld.clear();
+	for (uint32_t i = 0; i < mNodesOld.size(); ++i)
+		mIdxOld[mNodesOld[i].key] = i;
+
+	mStack.clear();
+	mCntSiblings.clear();
+	mLinesHead.clear();
+	mInfosNew.clear();
+	mIdxCur = cNodeProcNone;
+	mStructChanged = false;
+
+	// Frames start with a screen clear. Not part of the tree
+	while (pLine + 1 < pEnd && pLine[0] == '\033' && pLine[1] == '[')
+	{
+		// CSI sequence: ESC [ params final
+		pLine += 2;
+
+		while (pLine < pEnd && (*pLine < 0x40 || *pLine > 0x7E))
+			++pLine;
+
+		if (pLine < pEnd)
+			++pLine;
+	}
+
+	for (; pLine < pEnd; pLine = pLf + 1)
+	{
+		pLf = (const char *)memchr(pLine, '\n', pEnd - pLine);
+		if (!pLf)
+			pLf = pEnd;
+
+		len = pLf - pLine;
+		if (len && pLine[len - 1] == '\r')
+			--len;
+
+		lineAdd(pLine, len);
+	}
+
+	nodeFinish();
+
+	if (mNodes.size() != mNodesOld.size())
+		mStructChanged = true;
+
+	if (mStructChanged)
+		mGenStructure = mGen;
+
+	return mGen;
+}
+
+void ProcTree::clear()
+{
+	update("");
+}
+
+size_t ProcTree::changedSince(uint32_t gen, vector<uint32_t> &idxNodes) const
+{
+	idxNodes.clear();
+
+	for (uint32_t i = 0; i < mNodes.size(); ++i)
+	{
+		if (mNodes[i].genChanged > gen)
+			idxNodes.push_back(i);
+	}
+
+	return idxNodes.size();
+}
+
+void ProcTree::render(string &str) const
+{
+	vector<string>::const_iterator iter;
+
+	str.clear();
+
+	for (iter = mLinesHead.begin(); iter != mLinesHead.end(); ++iter)
+	{
+		str += *iter;
+		str += "\r\n";
+	}
+
+	for (size_t i = 0; i < mNodes.size(); ++i)
+	{
+		str += mNodes[i].line;
+		str += "\r\n";
+
+		iter = mNodes[i].infos.begin();
+		for (; iter != mNodes[i].infos.end(); ++iter)
+		{
+			str += *iter;
+			str += "\r\n";
+		}
+	}
+}
+
+/*
+ * Process lines contain 'Name()' followed by the state.
+ * All other lines belong to the preceding process
+ */
+void ProcTree::lineAdd(const char *pLine, size_t len)
+{
+	string line(pLine, len);
+	string text;
+	uint16_t indent = 0;
+	size_t posBrackets;
+
+	ansiStrip(pLine, len, text);
+
+	while (indent < text.size() && text[indent] == ' ')
+		++indent;
+
+	posBrackets = text.find("()", indent);
+	if (posBrackets != string::npos)
+	{
+		nodeAdd(line, text, indent);
+		return;
+	}
+
+	if (mIdxCur == cNodeProcNone)
+		mLinesHead.push_back(line);
+	else
+		mInfosNew.push_back(line);
+}
+
+void ProcTree::nodeAdd(string &line, const string &text, uint16_t indent)
+{
+	size_t posBrackets = text.find("()", indent);
+	size_t posName = text.rfind(' ', posBrackets);
+	uint32_t idxParent, idxNode, cntSiblings;
+	unordered_map<string, uint32_t>::iterator iter;
+	string key, name, state;
+
+	nodeFinish();
+
+	posName = posName == string::npos || posName < indent ? indent : posName + 1;
+	name = text.substr(posName, posBrackets - posName);
+
+	state = text.substr(posBrackets + 2);
+	trim(state);
+
+	while (mStack.size() && mStack.back().first >= indent)
+		mStack.pop_back();
+
+	idxParent = mStack.size() ? mStack.back().second : cNodeProcNone;
+
+	// Path of names. Equal siblings are numbered
+	if (idxParent != cNodeProcNone)
+		key = mNodes[idxParent].key;
+	key += "/";
+	key += name;
+
+	cntSiblings = mCntSiblings[key]++;
+	if (cntSiblings)
+		key += "#" + to_string(cntSiblings);
+
+	idxNode = mNodes.size();
+	mNodes.push_back(ProcNode());
+	ProcNode &node = mNodes.back();
+
+	iter = mIdxOld.find(key);
+	if (iter == mIdxOld.end())
+	{
+		node.genAdded = mGen;
+		node.genChanged = mGen;
+		mStructChanged = true;
+	}
+	else
+	{
+		node = std::move(mNodesOld[iter->second]);
+
+		if (iter->second != idxNode)
+			mStructChanged = true;
+
+		mIdxOld.erase(iter);
+	}
+
+	if (node.line != line || node.idxParent != idxParent)
+		node.genChanged = mGen;
+
+	node.key.swap(key);
+	node.name.swap(name);
+	node.state.swap(state);
+	node.line.swap(line);
+	node.idxParent = idxParent;
+	node.level = mStack.size();
+
+	mStack.push_back(make_pair(indent, idxNode));
+	mIdxCur = idxNode;
+}
+
+void ProcTree::nodeFinish()
+{
+	if (mIdxCur == cNodeProcNone)
+		return;
+
+	ProcNode &node = mNodes[mIdxCur];
+
+	if (node.infos != mInfosNew)
+	{
+		node.infos.swap(mInfosNew);
+		node.genChanged = mGen;
+	}
+
+	mInfosNew.clear();
+	mIdxCur = cNodeProcNone;
+}
+
+/* static functions */
+
+// Drops CSI and two-byte escape sequences
+void ansiStrip(const char *pLine, size_t len, string &text)
+{
+	const char *pEnd = pLine + len;
+
+	text.clear();
+	text.reserve(len);
+
+	for (; pLine < pEnd; ++pLine)
+	{
+		if (*pLine != '\033')
+		{
+			text.push_back(*pLine);
+			continue;
+		}
+
+		++pLine;
+		if (pLine >= pEnd)
+			break;
+
+		if (*pLine != '[')
+			continue;
+
+		for (++pLine; pLine < pEnd; ++pLine)
+		{
+			if (*pLine >= 0x40 && *pLine <= 0x7E)
+				break;
+		}
+	}
+}
+
+void trim(string &str)
+{
+	size_t posStart = str.find_first_not_of(" \t");
+
+	if (posStart == string::npos)
+	{
+		str.clear();
+		return;
+	}
+
+	str.erase(str.find_last_not_of(" \t") + 1);
+	str.erase(0, posStart);
+}
+
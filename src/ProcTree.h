@@ -0,0 +1,108 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PROC_TREE_H
+#define PROC_TREE_H
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+const uint32_t cNodeProcNone = 0xFFFFFFFF;
+
+struct ProcNode
+{
+	std::string key;
+	std::string name;
+	std::string state;
+	std::string line; // Raw. ANSI sequences included
+	std::vector<std::string> infos; // Raw
+	uint32_t idxParent;
+	uint16_t level;
+	uint32_t genAdded;
+	uint32_t genChanged;
+};
+
+/*
+ * Structured model of the process tree sent by the target.
+ *
+ * Each received frame is parsed into process nodes with
+ * name, state, level and info lines. Nodes are matched
+ * to the previous frame by their path of names. Matching
+ * nodes are reused and only get a new change generation
+ * if their lines differ.
+ *
+ * Consumers remember gen() and later ask for the nodes
+ * changed since then. If genStructure() is newer, nodes
+ * were added, removed or reordered => Indices changed
+ */
+class ProcTree
+{
+
+public:
+
+	ProcTree();
+
+	uint32_t update(const std::string &content);
+	void clear();
+
+	uint32_t gen() const { return mGen; }
+	uint32_t genStructure() const { return mGenStructure; }
+	size_t size() const { return mNodes.size(); }
+
+	const std::vector<ProcNode> &nodes() const { return mNodes; }
+	const std::vector<std::string> &linesHead() const { return mLinesHead; }
+
+	size_t changedSince(uint32_t gen, std::vector<uint32_t> &idxNodes) const;
+
+	// Inverse of update()
+	void render(std::string &str) const;
+
+private:
+
+	ProcTree(const ProcTree &) = delete;
+	ProcTree &operator=(const ProcTree &) = delete;
+
+	void lineAdd(const char *pLine, size_t len);
+	void nodeAdd(std::string &line, const std::string &text, uint16_t indent);
+	void nodeFinish();
+
+	std::vector<ProcNode> mNodes;
+	std::vector<ProcNode> mNodesOld;
+	std::unordered_map<std::string, uint32_t> mIdxOld;
+	std::vector<std::pair<uint16_t, uint32_t> > mStack;
+	std::unordered_map<std::string, uint32_t> mCntSiblings;
+	std::vector<std::string> mLinesHead;
+	std::vector<std::string> mInfosNew;
+	uint32_t mIdxCur;
+	bool mStructChanged;
+	uint32_t mGen;
+	uint32_t mGenStructure;
+
+};
+
+#endif
+
@@ -24,13 +24,15 @@
 */
 
 #include "RemoteCommanding.h"
-#include "SingleWireScheduling.h"
+#include "LibWakeup.h"
+#include "LibTime.h"
 
 #define dForEach_ProcState(gen) \
 		gen(StStart) \
 		gen(StSendReadyWait) \
 		gen(StWelcomeSend) \
 		gen(StMain) \
+		gen(StRespWait) \
 
 #define dGenProcStateEnum(s) s,
 dProcessStateEnum(ProcState);
@@ -44,15 +46,35 @@ using namespace std;
 
 const string cWelcomeMsg = "\r\n" dPackageName "\r\n" \
 			"Remote Terminal\r\n\r\n" \
-			"type 'help' or just 'h' for a list of available commands\r\n\r\n";
+			"type 'help' or just 'h' for a list of available commands\r\n" \
+			"type 'exit' or press Ctrl-D to quit\r\n\r\n";
 
-list<EntryHelp> RemoteCommanding::listCmds;
+const uint32_t cTimeoutResponseMs = 3000;
+const size_t cNumCandidatesMax = 32;
+const size_t cLenLineMax = 255;
 
-RemoteCommanding::RemoteCommanding(SOCKET fd)
+RemoteCommanding::RemoteCommanding(SOCKET fd,
+			SingleWireScheduling *pCtrl,
+			const CommandTrie *pTrieCmds)
 	: Processing("RemoteCommanding")
-	//, mStartMs(0)
+	, mStartMs(0)
 	, mFdSocket(fd)
+	, mpCtrl(pCtrl)
+	, mpTrieCmds(pTrieCmds)
 	, mpFilt(NULL)
+	, mIdSession(SingleWireScheduling::sessionIdCreate())
+	, mIdReq(0)
+	, mLine()
+	, mNodes()
+	, mGenTrie(0)
+	, mTabLast(false)
+	, mDone(false)
+#if CONFIG_APP_HAVE_PROFILING
+	, mProfTick()
+#endif
+#if CONFIG_APP_HAVE_ALLOC_TRACKING
+	, mAllocTick()
+#endif
 {
 	mState = StStart;
 }
@@ -61,12 +83,13 @@ RemoteCommanding::RemoteCommanding(SOCKET fd)
 
 Success RemoteCommanding::process()
 {
-	//uint32_t curTimeMs = millis();
-	//uint32_t diffMs = curTimeMs - mStartMs;
+	dProfileTick(mProfTick);
+	dAllocTick(mAllocTick);
+	uint32_t curTimeMs = millis();
+	uint32_t diffMs = curTimeMs - mStartMs;
 	Success success;
 	PipeEntry<KeyUser> entKey;
-	KeyUser key;
-	string msg;
+	string resp;
 #if 0
 	dStateTrace;
 #endif
@@ -77,6 +100,9 @@ Success RemoteCommanding::process()
 		if (mFdSocket == INVALID_SOCKET)
 			return procErrLog(-1, "socket file descriptor not set");
 
+		if (!mpCtrl || !mpTrieCmds)
+			return procErrLog(-1, "scheduler or command index not set");
+
 		mpFilt = TelnetFiltering::create(mFdSocket);
 		if (!mpFilt)
 			return procErrLog(-1, "could not create process");
@@ -86,6 +112,8 @@ Success RemoteCommanding::process()
 		mpFilt->procTreeDisplaySet(false);
 		start(mpFilt);
 
+		wakeupFdAdd(mFdSocket);
+
 		mState = StSendReadyWait;
 
 		break;
@@ -106,30 +134,342 @@ Success RemoteCommanding::process()
 		mpFilt->send(cWelcomeMsg.c_str(), cWelcomeMsg.size());
 		promptSend();
 
+		lineClear();
+
 		mState = StMain;
 
 		break;
 	case StMain:
 
-		if (mpFilt->ppKeys.get(entKey) < 1)
+		success = mpFilt->success();
+		if (success != Pending)
+			return success;
+
+		nodesSync();
+
+		while (mState == StMain && mpFilt->ppKeys.get(entKey) > 0)
+			keyProcess(entKey.particle);
+
+		if (mDone)
+		{
+			mpFilt->flush();
+			return Positive;
+		}
+
+		break;
+	case StRespWait:
+
+		success = mpFilt->success();
+		if (success != Pending)
+			return success;
+
+		if (mpCtrl->commandResponseGet(mIdReq, resp))
+		{
+			responseShow(resp);
+			promptSend(true, true);
+
+			mState = StMain;
 			break;
-		key = entKey.particle;
+		}
+
+		if (diffMs > cTimeoutResponseMs)
+		{
+			responseShow("No response from target");
+			promptSend(true, true);
 
-		procWrnLog("Got key: %s", key.str().c_str());
+			mState = StMain;
+			break;
+		}
 
-		// TODO: Implement 'Done' on empty string
+		wakeupDeadlineSet(mStartMs + cTimeoutResponseMs + 1);
 
 		break;
 	default:
 		break;
 	}
 
-	if (!msg.size())
-		return Pending;
+	// Everything produced in this tick as one segment
+	if (mpFilt)
+		mpFilt->flush();
+
+	return Pending;
+}
+
+Success RemoteCommanding::shutdown()
+{
+	if (mpFilt)
+		wakeupFdRemove(mFdSocket);
+
+	return Positive;
+}
+
+void RemoteCommanding::keyProcess(KeyUser &key)
+{
+	bool tab = key == keyTab;
+
+	if (key == keyEnter)
+		lineSubmit();
+	else
+	if (key == keyBackspace)
+		lineDelete();
+	else
+	if (tab)
+	{
+		if (mTabLast)
+			candidatesShow();
+		else
+			lineComplete();
+	}
+	else
+	if (key == keyEsc)
+	{
+		lineClear();
+		promptSend(true, true);
+	}
+	else
+	if (key.isPrint())
+		lineAppend(key.str());
+
+	mTabLast = tab;
+}
+
+void RemoteCommanding::lineAppend(const string &str)
+{
+	uint32_t node;
+
+	if (mLine.size() + str.size() > cLenLineMax)
+		return;
+
+	for (size_t i = 0; i < str.size(); ++i)
+	{
+		node = mNodes.back();
+
+		if (node != cNodeTrieNone)
+			node = mpTrieCmds->childGet(node, str[i]);
+
+		mNodes.push_back(node);
+		mLine.push_back(str[i]);
+	}
+
+	mpFilt->send(str.data(), str.size());
+}
+
+void RemoteCommanding::lineDelete()
+{
+	if (!mLine.size())
+		return;
+
+	// Multibyte characters are removed as a whole
+	do
+	{
+		mLine.erase(mLine.size() - 1);
+		mNodes.pop_back();
+	} while (mLine.size() && ((uint8_t)mLine.back() & 0xC0) == 0x80);
+
+	mpFilt->send("\b \b", 3);
+}
+
+void RemoteCommanding::lineClear()
+{
+	mLine.clear();
+
+	mNodes.clear();
+	mNodes.push_back(mpTrieCmds->root());
+
+	mGenTrie = mpTrieCmds->gen();
+}
+
+void RemoteCommanding::lineComplete()
+{
+	uint32_t node = mNodes.back();
+	string completion;
+
+	// Completion of arguments is up to the target
+	if (node == cNodeTrieNone)
+		return;
+
+	completion = mpTrieCmds->completionGet(node);
+
+	if (completion.size())
+	{
+		lineAppend(completion);
+		return;
+	}
+
+	if (mpTrieCmds->entryGet(node) && mpTrieCmds->cntCandidates(node) == 1)
+	{
+		lineAppend(" ");
+		return;
+	}
+
+	candidatesShow();
+}
+
+void RemoteCommanding::candidatesShow()
+{
+	uint32_t node = mNodes.back();
+	vector<const EntryHelp *> candidates;
+	size_t cntCandidates;
+	string msg;
+
+	cntCandidates = mpTrieCmds->cntCandidates(node);
+	if (cntCandidates < 2)
+		return;
+
+	mpTrieCmds->candidatesGet(node, candidates, cNumCandidatesMax);
+
+	msg += "\r\n";
+
+	for (size_t i = 0; i < candidates.size(); ++i)
+	{
+		msg += "  ";
+		msg += candidates[i]->id;
+
+		if (candidates[i]->desc.size())
+		{
+			msg += " - ";
+			msg += candidates[i]->desc;
+		}
+
+		msg += "\r\n";
+	}
+
+	if (cntCandidates > candidates.size())
+		msg += "  ... " + to_string(cntCandidates - candidates.size()) + " more\r\n";
 
 	mpFilt->send(msg.c_str(), msg.size());
 
-	return Pending;
+	promptSend();
+	mpFilt->send(mLine.c_str(), mLine.size());
+}
+
+void RemoteCommanding::lineSubmit()
+{
+	string cmd = mLine;
+	bool ok;
+
+	lineClear();
+
+	while (cmd.size() && cmd.back() == ' ')
+		cmd.erase(cmd.size() - 1);
+
+	if (!cmd.size())
+	{
+		promptSend(true, true);
+		return;
+	}
+
+	// Ctrl-D is handled by the filter
+	if (cmd == "exit" || cmd == "quit")
+	{
+		mpFilt->send("\r\n", 2);
+		mDone = true;
+		return;
+	}
+
+	if ((cmd == "help" || cmd == "h") && mpTrieCmds->size())
+	{
+		helpShow();
+		promptSend(true, true);
+		return;
+	}
+
+	ok = mpCtrl->commandSend(cmd, mIdReq, PrioUser, mIdSession, cTimeoutResponseMs);
+	if (!ok)
+	{
+		responseShow("Could not send command");
+		promptSend(true, true);
+		return;
+	}
+
+	mStartMs = millis();
+	mState = StRespWait;
+}
+
+void RemoteCommanding::responseShow(const string &resp)
+{
+	string msg = "\r\n";
+
+	for (size_t i = 0; i < resp.size(); ++i)
+	{
+		if (resp[i] == '\n' && (!i || resp[i - 1] != '\r'))
+			msg.push_back('\r');
+
+		msg.push_back(resp[i]);
+	}
+
+	mpFilt->send(msg.c_str(), msg.size());
+}
+
+void RemoteCommanding::helpShow()
+{
+	const vector<EntryHelp> &entries = mpTrieCmds->entries();
+	list<string> groups;
+	list<string>::iterator iterGroup;
+	string msg = "\r\n";
+	char buf[128];
+
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		iterGroup = groups.begin();
+		for (; iterGroup != groups.end(); ++iterGroup)
+		{
+			if (*iterGroup == entries[i].group)
+				break;
+		}
+
+		if (iterGroup == groups.end())
+			groups.push_back(entries[i].group);
+	}
+
+	iterGroup = groups.begin();
+	for (; iterGroup != groups.end(); ++iterGroup)
+	{
+		msg += iterGroup->size() ? *iterGroup : "Other";
+		msg += "\r\n";
+
+		for (size_t i = 0; i < entries.size(); ++i)
+		{
+			if (entries[i].group != *iterGroup)
+				continue;
+
+			snprintf(buf, sizeof(buf), "  %-24s %-4s %s\r\n",
+					entries[i].id.c_str(),
+					entries[i].shortcut.c_str(),
+					entries[i].desc.c_str());
+			msg += buf;
+		}
+	}
+
+	mpFilt->send(msg.c_str(), msg.size());
+}
+
+// Index was rebuilt => Walk the current line again
+void RemoteCommanding::nodesSync()
+{
+	string line;
+
+	if (mGenTrie == mpTrieCmds->gen())
+		return;
+
+	line.swap(mLine);
+
+	mLine.clear();
+	mNodes.clear();
+	mNodes.push_back(mpTrieCmds->root());
+	mGenTrie = mpTrieCmds->gen();
+
+	uint32_t node = mNodes.back();
+
+	for (size_t i = 0; i < line.size(); ++i)
+	{
+		if (node != cNodeTrieNone)
+			node = mpTrieCmds->childGet(node, line[i]);
+
+		mNodes.push_back(node);
+	}
+
+	mLine.swap(line);
 }
 
 void RemoteCommanding::promptSend(bool cursor, bool preNewLine, bool postNewLine)
@@ -158,15 +498,26 @@ void RemoteCommanding::processInfo(char *pBuf, char *pBufEnd)
 #if 1
 	dInfo("State\t\t\t%s\n", ProcStateString[mState]);
 #endif
+	dInfo("Session\t\t\t%u\n", mIdSession);
+	dInfo("Commands known\t\t%zu\n", mpTrieCmds ? mpTrieCmds->size() : 0);
+	dInfo("Line\t\t\t%s\n", mLine.c_str());
+	dProfileInfo(mProfTick);
+	dAllocInfo(mAllocTick);
 }
 
 /* static functions */
 
-void RemoteCommanding::listCommandsUpdate(const list<string> &listStr)
+/*
+ * Entry format: id|shortcut|desc|group
+ */
+void RemoteCommanding::listCommandsUpdate(const list<string> &listStr,
+					CommandTrie &trieCmds)
 {
 	list<string>::const_iterator iter;
-
-	listCmds.clear();
+	list<EntryHelp> listCmds;
+	EntryHelp entry;
+	string *fields[4] = { &entry.id, &entry.shortcut, &entry.desc, &entry.group };
+	size_t posStart, posEnd, idxField;
 
 	iter = listStr.begin();
 	for (; iter != listStr.end(); ++iter)
@@ -179,8 +530,29 @@ void RemoteCommanding::listCommandsUpdate(const list<string> &listStr)
 		if (str == "infoHelp|||")
 			continue;
 
-		wrnLog("Entry received: %s", str.c_str());
-		// TODO: Parse
+		posStart = 0;
+		idxField = 0;
+
+		for (; idxField < 4; ++idxField)
+		{
+			posEnd = idxField < 3 ? str.find('|', posStart) : string::npos;
+
+			if (posEnd == string::npos)
+				posEnd = str.size();
+
+			if (posStart > str.size())
+				posStart = str.size();
+
+			fields[idxField]->assign(str, posStart, posEnd - posStart);
+			posStart = posEnd + 1;
+		}
+
+		if (!entry.id.size())
+			continue;
+
+		listCmds.push_back(entry);
 	}
+
+	trieCmds.build(listCmds);
 }
 
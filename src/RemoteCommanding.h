@@ -26,32 +26,35 @@
 #ifndef REMOTE_COMMANDING_H
 #define REMOTE_COMMANDING_H
 
+#include <vector>
+
 #include "Processing.h"
+#include "LibProfiling.h"
+#include "LibAllocTracking.h"
 #include "TelnetFiltering.h"
-
-struct EntryHelp
-{
-	std::string id;
-	std::string shortcut;
-	std::string desc;
-	std::string group;
-};
+#include "SingleWireScheduling.h"
+#include "CommandTrie.h"
 
 class RemoteCommanding : public Processing
 {
 
 public:
 
-	static RemoteCommanding *create(SOCKET fd)
+	static RemoteCommanding *create(SOCKET fd,
+					SingleWireScheduling *pCtrl,
+					const CommandTrie *pTrieCmds)
 	{
-		return new dNoThrow RemoteCommanding(fd);
+		return new dNoThrow RemoteCommanding(fd, pCtrl, pTrieCmds);
 	}
 
-	static void listCommandsUpdate(const std::list<std::string> &listStr);
+	static void listCommandsUpdate(const std::list<std::string> &listStr,
+					CommandTrie &trieCmds);
 
 protected:
 
-	RemoteCommanding(SOCKET fd);
+	RemoteCommanding(SOCKET fd,
+				SingleWireScheduling *pCtrl,
+				const CommandTrie *pTrieCmds);
 	virtual ~RemoteCommanding() {}
 
 private:
@@ -67,19 +70,44 @@ private:
 
 	/* member functions */
 	Success process();
+	Success shutdown();
 	void processInfo(char *pBuf, char *pBufEnd);
 
 	void promptSend(bool cursor = true, bool preNewLine = false, bool postNewLine = false);
+	void keyProcess(KeyUser &key);
+	void lineAppend(const std::string &str);
+	void lineDelete();
+	void lineClear();
+	void lineComplete();
+	void candidatesShow();
+	void lineSubmit();
+	void responseShow(const std::string &resp);
+	void helpShow();
+	void nodesSync();
 
 	/* member variables */
-	//uint32_t mStartMs;
+	uint32_t mStartMs;
 	SOCKET mFdSocket;
+	SingleWireScheduling *mpCtrl;
+	const CommandTrie *mpTrieCmds;
 	TelnetFiltering *mpFilt;
-
+	uint32_t mIdSession;
+	uint32_t mIdReq;
+	std::string mLine;
+	std::vector<uint32_t> mNodes;
+	uint32_t mGenTrie;
+	bool mTabLast;
+	bool mDone;
+
+#if CONFIG_APP_HAVE_PROFILING
+	ProfileTick mProfTick;
+#endif
+#if CONFIG_APP_HAVE_ALLOC_TRACKING
+	AllocStats mAllocTick;
+#endif
 	/* static functions */
 
 	/* static variables */
-	static std::list<EntryHelp> listCmds;
 
 	/* constants */
 
@@ -0,0 +1,117 @@
+/*
+  This file is part of the DSP-Crowd project
+  https://www.dsp-crowd.com
+
+  Author(s):
+      - Johannes Natter, office@dsp-crowd.com
+
+  File created on 19.10.2026
+
+  Copyright (C) 2026, Johannes Natter
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RING_SPSC_H
+#define RING_SPSC_H
+
+#include <cstddef>
+#include <atomic>
+#include <utility>
+
+/*
+ * Lock-free ring buffer for exactly one producer
+ * thread and exactly one consumer thread.
+ *
+ * Items are moved in and out. The slots are
+ * allocated once, so std::string items keep their
+ * capacity and stop allocating in steady state.
+ *
+ * Literature
+ * - https://www.1024cores.net/home/lock-free-algorithms/queues
+ * - https://en.cppreference.com/w/cpp/atomic/memory_order
+ */
+template <typename T, size_t N>
+class RingSpsc
+{
+
+	static_assert(N && !(N & (N - 1)), "size of ring must be a power of two");
+
+public:
+
+	RingSpsc()
+		: mIdxWrite(0)
+		, mIdxRead(0)
+	{}
+
+	// Producer
+	bool commit(T &&item)
+	{
+		size_t idxWrite = mIdxWrite.load(std::memory_order_relaxed);
+		size_t idxRead = mIdxRead.load(std::memory_order_acquire);
+
+		if (idxWrite - idxRead >= N)
+			return false;
+
+		mItems[idxWrite & (N - 1)] = std::move(item);
+		mIdxWrite.store(idxWrite + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	bool commit(const T &item)
+	{
+		T tmp(item);
+		return commit(std::move(tmp));
+	}
+
+	// Consumer
+	bool get(T &item)
+	{
+		size_t idxRead = mIdxRead.load(std::memory_order_relaxed);
+		size_t idxWrite = mIdxWrite.load(std::memory_order_acquire);
+
+		if (idxRead == idxWrite)
+			return false;
+
+		item = std::move(mItems[idxRead & (N - 1)]);
+		mIdxRead.store(idxRead + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	// Either side. Only a snapshot
+	size_t size() const
+	{
+		size_t idxWrite = mIdxWrite.load(std::memory_order_acquire);
+		size_t idxRead = mIdxRead.load(std::memory_order_acquire);
+
+		return idxWrite - idxRead;
+	}
+
+private:
+
+	RingSpsc(const RingSpsc &) = delete;
+	RingSpsc &operator=(const RingSpsc &) = delete;
+
+	T mItems[N];
+
+	// Separate cache lines. Avoids false sharing between the threads
+	alignas(64) std::atomic<size_t> mIdxWrite;
+	alignas(64) std::atomic<size_t> mIdxRead;
+
+};
+
+#endif
+
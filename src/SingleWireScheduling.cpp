@@ -27,6 +27,15 @@
 #include "SystemDebugging.h"
 #include "LibTime.h"
 #include "LibDspc.h"
+#include "LibWakeup.h"
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include <fcntl.h>
+#include <ctime>
 
 #include "env.h"
 
@@ -34,6 +43,7 @@
 		gen(StStart) \
 		gen(StUartInit) \
 		gen(StDevUartInit) \
+		gen(StDevUartWait) \
 		gen(StTargetInit) \
 		gen(StTargetInitDoneWait) \
 		gen(StNextFlowDetermine) \
@@ -86,49 +96,184 @@ const uint8_t cKeyTab = '\t';
 const uint8_t cKeyCr = '\r';
 const uint8_t cKeyLf = '\n';
 
-static uint8_t uartVirtualTimeout = 0;
-RefDeviceUart refUart;
-
 const size_t cNumRequestsCmdMax = 40;
 const uint32_t cTimeoutCmduC = 100;
-const uint32_t cTimeoutCmdReq = 5500;
 
-list<CommandReqResp> SingleWireScheduling::requestsCmd[3];
-list<CommandReqResp> SingleWireScheduling::responsesCmd;
-uint32_t SingleWireScheduling::idReqCmdNext = 0;
+/*
+ * Default share of the wire per priority class.
+ * Only the ratios matter. Requests closer than
+ * cDeadlineUrgentMs to their deadline bypass shares
+ */
+const uint32_t cSharesPrioDefault[cNumPrioCmd] = { 5, 3, 2 };
+const uint32_t cStridePrio = 1 << 16;
+const uint32_t cDeadlineUrgentMs = 300;
+
+/*
+ * Idle targets answer polls with IdContentNone. After a
+ * few of those in a row the poll interval is doubled
+ * on every further empty answer, up to the bound below
+ */
+const uint32_t cNumContentNoneNoDelay = 4;
+const uint32_t cDelayPollMaxMs = 32;
+
+/*
+ * Answer of the target to the initialization code.
+ * Newer targets append ' <firmware identity>'
+ */
+const string cRespTargetInit = "Debug mode 1";
+
+// Fallback when hotplug detection is not available or open() failed
+const uint32_t cDelayRetryDevUartMs = 500;
+#if CONFIG_PROC_HAVE_DRIVERS
+// Scheduler has its own thread. Blocking is fine
+const uint32_t cTimeoutWatchDevUartMs = 100;
+#else
+const uint32_t cTimeoutWatchDevUartMs = 0;
+#endif
+
+static void fdsWaitSet(DeviceUart &dev, bool wait);
+static size_t idxContent(uint8_t idContent);
+static bool passBefore(uint32_t passA, uint32_t passB);
+static bool deadlinePassed(uint32_t deadlineMs, uint32_t curTimeMs);
+
+const char *cNamesIdxContent[cNumIdxContent] =
+{
+	"none", "proc", "log", "cmd", "cmd_out"
+};
+
+const char *cNamesPrioCmd[cNumPrioCmd] =
+{
+	"sys_high", "user", "sys_low"
+};
+
+SwtMetrics::SwtMetrics()
+	: errProtocol(0)
+	, uartOnline(0)
+	, uartOffline(0)
+	, targetOnline(0)
+	, targetOffline(0)
+{
+	for (size_t i = 0; i < cNumIdxContent; ++i)
+	{
+		bytesContent[i].store(0);
+		framesContent[i].store(0);
+	}
+
+	for (size_t i = 0; i < cNumPrioCmd; ++i)
+		depthQueueCmd[i].store(0);
+}
+
+vector<SingleWireScheduling *> SingleWireScheduling::instances;
+size_t SingleWireScheduling::idxInstanceSel = 0;
+bool SingleWireScheduling::cmdsRegistered = false;
+uint32_t SingleWireScheduling::idSessionNext = 1;
 
-SingleWireScheduling::SingleWireScheduling()
+SingleWireScheduling::SingleWireScheduling(const string &deviceUart)
 	: Processing("SingleWireScheduling")
 	, mDevUartIsOnline(false)
 	, mTargetIsOnline(false)
-	, mContentProc("")
+	, rgEntriesLog()
+	, rgTap()
 	, mStateSwt(StSwtContentRcvWait)
+	, mStateFlight(0xFFFFFFFF)
+	, mStateSwtFlight(0xFFFFFFFF)
+	, mIdFlight(flightSourceCreate())
 	, mStartMs(0)
-	, mRefUart(RefDeviceUartInvalid)
+	, mDeviceUart(deviceUart)
+	, mUart()
+	, mMtxUart()
 	, mpBuf(NULL)
 	, mLenDone(0)
 	, mFragments()
-	, mContentProcChanged(false)
+	, mpContentProc(std::make_shared<const string>(dContentProcPrefix))
+	, mEntryLog()
+	, mRcvdUs(0)
+	, mFrameFirstUs(0)
+	, mFrameLastUs(0)
+	, mCntEntriesLogDropped(0)
+	, mTapActive(false)
+	, mBufTap()
+	, mCntTapDropped(0)
+	, mMetrics()
+	, mMtxIdFirmware()
+	, mMtxContentProc()
+	, mpContentProcPending()
+	, mIdFirmware()
 	, mCntBytesRcvd(0)
 	, mCntContentNoneRcvd(0)
 	, mLastProcTreeRcvdMs(0)
 	, mTargetIsOnlineOld(true)
 	, mTargetIsOfflineMarked(false)
 	, mContentIgnore(false)
-	, mpListCmdCurrent(NULL)
-	, mCntDelayPrioLow(0)
+	, mCmdCurrent()
+	, mCmdCurrentPending(false)
 	, mStartCmdMs(0)
+	, mCntStreakContentNone(0)
+	, mDelayPollMs(0)
+	, mPollDoneMs(0)
+	, mRingReqCmd()
+	, mRingRespCmd()
+	, mRequestsCmd()
+	, mPassVirtual(0)
+	, mCntCmdExpired(0)
+	, mResponsesCmd()
+	, mIdReqCmdNext(0)
+	, mCacheCmd()
+	, mCntCacheHits(0)
+	, mCntCacheCoalesced(0)
+	, mHistQueueCmd()
+	, mHistRoundTripCmd()
+	, mHistTurnaroundPoll()
+	, mStartCmdUs(0)
+	, mStartPollUs(0)
+	, mPollPending(false)
+#if CONFIG_APP_HAVE_PROFILING
+	, mProfTick()
+#endif
+#if CONFIG_APP_HAVE_ALLOC_TRACKING
+	, mAllocTick()
+#endif
 {
 	responseReset();
 	mBufRcv[0] = 0;
 
+	for (size_t i = 0; i < cNumPrioCmd; ++i)
+	{
+		mSharesPrio[i].store(cSharesPrioDefault[i]);
+		mPassPrio[i] = 0;
+		mIdSessionLast[i] = 0;
+		mCntCmdServed[i] = 0;
+	}
+
+	instances.push_back(this);
+
 	mState = StStart;
 }
 
+SingleWireScheduling::~SingleWireScheduling()
+{
+	vector<SingleWireScheduling *>::iterator iter;
+
+	iter = instances.begin();
+	for (; iter != instances.end(); ++iter)
+	{
+		if (*iter != this)
+			continue;
+
+		instances.erase(iter);
+		break;
+	}
+
+	if (idxInstanceSel >= instances.size())
+		idxInstanceSel = 0;
+}
+
 /* member functions */
 
 Success SingleWireScheduling::process()
 {
+	dProfileTick(mProfTick);
+	dAllocTick(mAllocTick);
 	uint32_t curTimeMs = millis();
 	//uint32_t diffMs = curTimeMs - mStartMs;
 	Success success;
@@ -136,10 +281,25 @@ Success SingleWireScheduling::process()
 #if 0
 	dStateTrace;
 #endif
+	flightStatesCheck();
+
 	switch (mState)
 	{
 	case StStart:
 
+		if (cmdsRegistered)
+		{
+			mState = StUartInit;
+			break;
+		}
+		cmdsRegistered = true;
+
+		flightNamesSet(FlightState, ProcStateString,
+				sizeof(ProcStateString) / sizeof(ProcStateString[0]));
+		flightNamesSet(FlightStateSwt, SwtStateString,
+				sizeof(SwtStateString) / sizeof(SwtStateString[0]));
+
+		cmdReg("targetSel",        cmdTargetSelect,          "",  "Select target for commands: [index]", "Targets");
 		cmdReg("ctrlManualToggle", cmdCtrlManualToggle,      "",  "Toggle manual control",               "Manual Control");
 		cmdReg("dataUartSend",     cmdDataUartSend,          "",  "Send byte stream",                    "Manual Control");
 		cmdReg("strUartSend",      cmdStrUartSend,           "",  "Send string",                         "Manual Control");
@@ -151,19 +311,24 @@ Success SingleWireScheduling::process()
 		cmdReg("dataUartRcv",      cmdDataUartRcv,           "",  "Receive byte stream",                 "Virtual UART");
 		cmdReg("strUartRcv",       cmdStrUartRcv,            "",  "Receive string",                      "Virtual UART");
 		cmdReg("cmdSend",          cmdCommandSend,           "",  "Send command",                        "Commands");
+		cmdReg("cmdSharesSet",     cmdSharesSet,             "",  "Wire shares: [sysHigh user sysLow]",  "Commands");
+		cmdReg("cmdCacheSet",      cmdCacheSet,              "",  "Cache results: [ttlMs command]",      "Commands");
+		cmdReg("latencyReset",     cmdLatencyReset,          "",  "Reset latency histograms",            "Diagnostics");
+		cmdReg("flightDump",       cmdFlightDump,            "",  "Dump flight recorder to file",        "Diagnostics");
 
 		mState = StUartInit;
 
 		break;
 	case StUartInit:
 
-		if (mRefUart != RefDeviceUartInvalid)
 		{
-			devUartDeInit(mRefUart);
-			refUart = mRefUart;
+			Guard lock(mMtxUart);
+
+			fdsWaitSet(mUart, false);
+			devUartDeInit(mUart);
 		}
 
-		mDevUartIsOnline = false;
+		devUartOnlineSet(false);
 		targetOnlineSet(false);
 
 		mState = StDevUartInit;
@@ -171,20 +336,73 @@ Success SingleWireScheduling::process()
 		break;
 	case StDevUartInit:
 
-		success = devUartInit(env.deviceUart, mRefUart);
+		{
+			Guard lock(mMtxUart);
+			success = devUartInit(mDeviceUart, mUart);
+		}
+
 		if (success == Pending)
+		{
+			if (mUart.virtualEnabled)
+				break;
+
+			// Device may have appeared before the watch was set up
+			// => Try once more after watch is active
+			if (mUart.fdWatch < 0 &&
+					devUartWatchInit(mDeviceUart, mUart))
+			{
+				fdsWaitSet(mUart, true);
+				break;
+			}
+
+			mStartMs = curTimeMs;
+			mState = StDevUartWait;
+
 			break;
+		}
 
 		if (success != Positive)
 			return procErrLog(-1, "could not initalize UART device");
 
 		// clear UART device buffer?
 
-		mDevUartIsOnline = true;
-		refUart = mRefUart;
+		fdsWaitSet(mUart, false);
+		devUartWatchDeInit(mUart);
+
+		fdsWaitSet(mUart, true);
+		devUartOnlineSet();
 
 		mState = StTargetInit;
 
+		break;
+	case StDevUartWait:
+
+		if (mUart.virtualEnabled)
+		{
+			mState = StDevUartInit;
+			break;
+		}
+
+		/*
+		 * Always retry periodically. The node may exist
+		 * already but open() failed: Permissions not yet
+		 * applied by udev or device busy. No further
+		 * event would arrive in that case
+		 */
+		if (curTimeMs - mStartMs >= cDelayRetryDevUartMs)
+		{
+			mState = StDevUartInit;
+			break;
+		}
+
+		if (mUart.fdWatch < 0)
+			break;
+
+		if (!devUartAppeared(mDeviceUart, mUart, cTimeoutWatchDevUartMs))
+			break;
+
+		mState = StDevUartInit;
+
 		break;
 	case StTargetInit:
 
@@ -227,13 +445,14 @@ Success SingleWireScheduling::process()
 		if (mResp.idContent != IdContentCmd)
 			break;
 
-		if (mResp.content != "Debug mode 1")
+		if (!targetInitRespCheck(mResp.content))
 			break;
 
 		targetOnlineSet();
 
-		mpListCmdCurrent = NULL;
+		mCmdCurrentPending = false;
 		mStartCmdMs = 0;
+		pollDelayUpdate(false);
 
 		mState = StNextFlowDetermine;
 
@@ -250,10 +469,13 @@ Success SingleWireScheduling::process()
 
 		// flow determine
 
-		ok = cmdQueueCheck();
+		ok = cmdQueueCheck(curTimeMs);
 		if (ok)
 			break;
 
+		if (pollDelayed(curTimeMs))
+			break;
+
 		dataRequest();
 		mState = StContentReceiveWait;
 
@@ -285,21 +507,37 @@ Success SingleWireScheduling::process()
 #endif
 		}
 #endif
+		// Empty tree => No fragment and no prefix
+		if (mResp.idContent == IdContentProc && !mResp.content.size())
+			mResp.content = dContentProcPrefix;
+
 		if (mResp.idContent == IdContentProc &&
-				mContentProc != mResp.content)
+				*mpContentProc != mResp.content)
 		{
 			mTargetIsOfflineMarked = false;
 
-			mContentProc = mResp.content;
-			mContentProcChanged = true;
+			mpContentProc = std::make_shared<const string>(std::move(mResp.content));
+			contentProcPublish();
 		}
 
 		if (mResp.idContent == IdContentLog)
-			ppEntriesLog.commit(mResp.content);
+		{
+			mEntryLog.str = std::move(mResp.content);
+			mEntryLog.firstUs = mFrameFirstUs;
+			mEntryLog.lastUs = mFrameLastUs;
+
+			if (rgEntriesLog.commit(std::move(mEntryLog)))
+				wakeupNotify();
+			else
+				++mCntEntriesLogDropped;
+		}
 
 		if (mResp.idContent == IdContentCmd)
 			cmdResponseReceived(mResp.content);
 
+		pollDelayUpdate(mResp.idContent == IdContentNone);
+		mPollDoneMs = curTimeMs;
+
 		responseReset();
 
 		mState = StNextFlowDetermine;
@@ -318,69 +556,245 @@ Success SingleWireScheduling::process()
 		break;
 	}
 
+#if !CONFIG_PROC_HAVE_DRIVERS
+	wakeupSchedule(curTimeMs);
+#endif
 	return Pending;
 }
 
-bool SingleWireScheduling::contentProcChanged()
+/*
+ * Weighted fair queueing with stride scheduling
+ * - Each priority class gets its share of the wire
+ * - Requests close to their deadline are served first
+ * - Within a class the sessions take turns
+ *
+ * Literature
+ * - https://en.wikipedia.org/wiki/Stride_scheduling
+ * - https://en.wikipedia.org/wiki/Earliest_deadline_first_scheduling
+ */
+bool SingleWireScheduling::cmdQueueCheck(uint32_t curTimeMs)
 {
-	bool tmp = mContentProcChanged;
-	mContentProcChanged = false;
-	return tmp;
+	if (mCmdCurrentPending)
+		return false;
+
+	cmdRequestsExpire(curTimeMs);
+
+	CmdIter iter;
+	size_t prio;
+
+	if (!cmdNextSelect(curTimeMs, prio, iter))
+		return false;
+
+	mCmdCurrent = std::move(*iter);
+	mRequestsCmd[prio].erase(iter);
+	queueDepthsUpdate();
+
+	mCmdCurrentPending = true;
+	mIdSessionLast[prio] = mCmdCurrent.idSession;
+
+	mPassVirtual = mPassPrio[prio];
+	mPassPrio[prio] += cStridePrio / mSharesPrio[prio].load(memory_order_relaxed);
+	++mCntCmdServed[prio];
+
+	mStartCmdMs = millis();
+	mStartCmdUs = usMonotonic();
+
+	if (!mCmdCurrent.cntSent)
+		mHistQueueCmd[prio].add(mStartCmdUs - mCmdCurrent.startUs);
+	++mCmdCurrent.cntSent;
+
+	cmdSend(mCmdCurrent.str);
+
+	return true;
 }
 
-bool SingleWireScheduling::cmdQueueCheck()
+bool SingleWireScheduling::cmdNextSelect(uint32_t curTimeMs, size_t &prio, CmdIter &iterSel)
 {
-	if (mpListCmdCurrent)
-		return false;
+	CmdIter iter;
+	uint32_t remainingMs, remainingMinMs = cDeadlineUrgentMs;
+	size_t prioSel = cNumPrioCmd;
 
-	if (requestsCmd[PrioUser].size())
-		mpListCmdCurrent = &requestsCmd[PrioUser];
-	else
-	if (requestsCmd[PrioSysLow].size())
+	// Urgent requests first. Earliest deadline wins
+	for (size_t i = 0; i < cNumPrioCmd; ++i)
 	{
-		if (mCntDelayPrioLow)
-			return false;
+		iter = mRequestsCmd[i].begin();
+		for (; iter != mRequestsCmd[i].end(); ++iter)
+		{
+			remainingMs = iter->deadlineMs - curTimeMs;
+
+			if (remainingMs >= remainingMinMs)
+				continue;
+
+			remainingMinMs = remainingMs;
+			prioSel = i;
+			iterSel = iter;
+		}
+	}
+
+	if (prioSel < cNumPrioCmd)
+	{
+		prio = prioSel;
+		return true;
+	}
+
+	// Otherwise the class which is most behind its share
+	for (size_t i = 0; i < cNumPrioCmd; ++i)
+	{
+		if (!mRequestsCmd[i].size())
+			continue;
 
-		mpListCmdCurrent = &requestsCmd[PrioSysLow];
-		mCntDelayPrioLow = 4;
+		if (prioSel < cNumPrioCmd &&
+				!passBefore(mPassPrio[i], mPassPrio[prioSel]))
+			continue;
+
+		prioSel = i;
 	}
 
-	if (!mpListCmdCurrent)
+	if (prioSel >= cNumPrioCmd)
 		return false;
-	mStartCmdMs = millis();
 
-	const CommandReqResp *pReq = &mpListCmdCurrent->front();
-	cmdSend(pReq->str);
+	prio = prioSel;
+	iterSel = cmdSessionSelect(mRequestsCmd[prioSel], mIdSessionLast[prioSel]);
 
 	return true;
 }
 
-void SingleWireScheduling::cmdResponseReceived(const string &resp)
+/*
+ * Round robin over the sessions. The next session ID
+ * after the last one served wins. Oldest request of
+ * that session first
+ */
+CmdIter SingleWireScheduling::cmdSessionSelect(list<CommandReqResp> &requests, uint32_t idSessionLast)
+{
+	CmdIter iter, iterSel;
+	uint32_t dist, distMin = 0;
+
+	iterSel = requests.begin();
+	iter = requests.begin();
+	for (; iter != requests.end(); ++iter)
+	{
+		// Last session served gets the largest distance
+		dist = iter->idSession - idSessionLast - 1;
+
+		if (iter != requests.begin() && dist >= distMin)
+			continue;
+
+		distMin = dist;
+		iterSel = iter;
+	}
+
+	return iterSel;
+}
+
+void SingleWireScheduling::cmdRequestsExpire(uint32_t curTimeMs)
+{
+	CmdIter iter;
+
+	for (size_t i = 0; i < cNumPrioCmd; ++i)
+	{
+		iter = mRequestsCmd[i].begin();
+		while (iter != mRequestsCmd[i].end())
+		{
+			if (!deadlinePassed(iter->deadlineMs, curTimeMs))
+			{
+				++iter;
+				continue;
+			}
+
+			procDbgLog("deadline passed for request %u", iter->idReq);
+			++mCntCmdExpired;
+
+			iter = mRequestsCmd[i].erase(iter);
+		}
+	}
+
+	queueDepthsUpdate();
+}
+
+void SingleWireScheduling::cmdResponseReceived(string &resp)
 {
-	if (!mpListCmdCurrent)
+	if (!mCmdCurrentPending)
 		return;
+
+	mHistRoundTripCmd.add(usMonotonic() - mStartCmdUs);
 #if 0
 	procWrnLog("command response received: %s",
 				resp.c_str());
 #endif
-	uint32_t idReq = mpListCmdCurrent->front().idReq;
-	mpListCmdCurrent->pop_front();
-	responsesCmd.emplace_back(resp, idReq, millis());
+	uint32_t idReq = mCmdCurrent.idReq;
+
+	if (mRingRespCmd.commit(CommandReqResp(std::move(resp), idReq, millis())))
+		wakeupNotify();
+	else
+		procWrnLog("could not hand over response for: %u", idReq);
 
-	mpListCmdCurrent = NULL;
+	mCmdCurrentPending = false;
 }
 
 void SingleWireScheduling::commandsCheck(uint32_t curTimeMs)
 {
-	cmdResponsesClear(curTimeMs);
+	cmdRequestsFetch();
 
-	if (!mpListCmdCurrent)
+	if (!mCmdCurrentPending)
 		return;
 
 	uint32_t diffMs = curTimeMs - mStartCmdMs;
 
-	if (diffMs > cTimeoutCmduC)
-		mpListCmdCurrent = NULL;
+	if (diffMs <= cTimeoutCmduC)
+		return;
+
+	mCmdCurrentPending = false;
+
+	if (deadlinePassed(mCmdCurrent.deadlineMs, curTimeMs))
+	{
+		++mCntCmdExpired;
+		return;
+	}
+
+	// Retry. Keeps its place in the session
+	mRequestsCmd[mCmdCurrent.prio].push_front(std::move(mCmdCurrent));
+	queueDepthsUpdate();
+}
+
+void SingleWireScheduling::cmdRequestsFetch()
+{
+	CommandReqResp req;
+	list<CommandReqResp> *pList;
+
+	/*
+	 * Never drop here. The caller already got an ID and
+	 * would wait for its timeout. The bound is enforced
+	 * in commandSend() instead
+	 */
+	while (mRingReqCmd.get(req))
+	{
+		pList = &mRequestsCmd[req.prio];
+
+		// Idle classes don't save up credit
+		if (!pList->size() && passBefore(mPassPrio[req.prio], mPassVirtual))
+			mPassPrio[req.prio] = mPassVirtual;
+
+		pList->push_back(std::move(req));
+		queueDepthsUpdate();
+
+		// Commands must not wait for an idle target
+		pollDelayUpdate(false);
+	}
+}
+
+void SingleWireScheduling::cmdResponsesFetch()
+{
+	CommandReqResp resp;
+
+	while (mRingRespCmd.get(resp))
+	{
+		if (mCacheCmd.size())
+			cmdCacheFill(resp);
+
+		mResponsesCmd.push_back(std::move(resp));
+	}
+
+	cmdResponsesClear(millis());
 }
 
 void SingleWireScheduling::cmdResponsesClear(uint32_t curTimeMs)
@@ -388,8 +802,8 @@ void SingleWireScheduling::cmdResponsesClear(uint32_t curTimeMs)
 	list<CommandReqResp>::iterator iter;
 	uint32_t diffMs;
 
-	iter = responsesCmd.begin();
-	while (iter != responsesCmd.end())
+	iter = mResponsesCmd.begin();
+	while (iter != mResponsesCmd.end())
 	{
 		diffMs = curTimeMs - iter->startMs;
 
@@ -402,17 +816,105 @@ void SingleWireScheduling::cmdResponsesClear(uint32_t curTimeMs)
 		procWrnLog("response timeout for: %u",
 					iter->idReq);
 #endif
-		iter = responsesCmd.erase(iter);
+		iter = mResponsesCmd.erase(iter);
+	}
+}
+
+/*
+ * Only needed when the scheduler shares the main thread.
+ * Otherwise the internal driver ticks us
+ */
+void SingleWireScheduling::wakeupSchedule(uint32_t curTimeMs)
+{
+	switch (mState)
+	{
+	case StTargetInitDoneWait:
+	case StContentReceiveWait:
+
+		// UART descriptor is registered as well
+		wakeupDeadlineSet(mStartMs + dTimeoutTargetInitMs + 1);
+
+		break;
+	case StDevUartWait:
+
+		wakeupDeadlineSet(mStartMs + cDelayRetryDevUartMs);
+
+		break;
+	case StNextFlowDetermine:
+
+		wakeupDeadlineSet(mPollDoneMs + mDelayPollMs);
+
+		break;
+	case StCtrlManual:
+		break;
+	default:
+
+		wakeupDeadlineSet(curTimeMs);
+
+		break;
+	}
+}
+
+bool SingleWireScheduling::pollDelayed(uint32_t curTimeMs)
+{
+	if (!mDelayPollMs)
+		return false;
+
+	return curTimeMs - mPollDoneMs < mDelayPollMs;
+}
+
+void SingleWireScheduling::pollDelayUpdate(bool contentNone)
+{
+	if (!contentNone)
+	{
+		mCntStreakContentNone = 0;
+		mDelayPollMs = 0;
+		return;
+	}
+
+	++mCntStreakContentNone;
+
+	if (mCntStreakContentNone <= cNumContentNoneNoDelay)
+		return;
+
+	if (!mDelayPollMs)
+	{
+		mDelayPollMs = 1;
+		return;
 	}
+
+	mDelayPollMs <<= 1;
+
+	if (mDelayPollMs > cDelayPollMaxMs)
+		mDelayPollMs = cDelayPollMaxMs;
 }
 
 void SingleWireScheduling::cmdSend(const string &cmd)
 {
-	uartSend(mRefUart, FlowCtrlToTarget);
-	uartSend(mRefUart, IdContentOutCmd);
-	uartSend(mRefUart, cmd.data(), cmd.size());
-	uartSend(mRefUart, 0x00);
-	uartSend(mRefUart, IdContentEnd);
+	{
+		Guard lock(mMtxUart);
+
+		uartSend(mUart, FlowCtrlToTarget);
+		uartSend(mUart, IdContentOutCmd);
+		uartSend(mUart, cmd.data(), cmd.size());
+		uartSend(mUart, 0x00);
+		uartSend(mUart, IdContentEnd);
+	}
+
+	if (mTapActive.load(memory_order_relaxed))
+	{
+		static const uint8_t bytesStart[] = { FlowCtrlToTarget, IdContentOutCmd };
+		static const uint8_t bytesEnd[] = { 0x00, IdContentEnd };
+
+		tapRecord('T', bytesStart, sizeof(bytesStart));
+		tapRecord('T', cmd.data(), cmd.size());
+		tapRecord('T', bytesEnd, sizeof(bytesEnd));
+	}
+
+	flightRecord(FlightCmd, mIdFlight, cmd.data(), cmd.size());
+
+	cntInc(mMetrics.bytesContent[IdxContentCmdOut], cmd.size() + 4);
+	cntInc(mMetrics.framesContent[IdxContentCmdOut]);
 
 	mStartMs = millis();
 
@@ -421,16 +923,21 @@ void SingleWireScheduling::cmdSend(const string &cmd)
 
 void SingleWireScheduling::dataRequest()
 {
-	uartSend(mRefUart, FlowTargetToCtrl);
+	{
+		Guard lock(mMtxUart);
+		uartSend(mUart, FlowTargetToCtrl);
+	}
+
 	mStartMs = millis();
 
-	//procWrnLog("data requested");
+	uint8_t flow = FlowTargetToCtrl;
+	flightRecord(FlightUartTx, mIdFlight, &flow, sizeof(flow));
+	tapRecord('T', &flow, sizeof(flow));
 
-	if (mCntDelayPrioLow)
-	{
-		--mCntDelayPrioLow;
-		//procWrnLog("low prio delay: %u", mCntDelayPrioLow);
-	}
+	mStartPollUs = usMonotonic();
+	mPollPending = true;
+
+	//procWrnLog("data requested");
 }
 
 Success SingleWireScheduling::dataReceive()
@@ -445,6 +952,7 @@ Success SingleWireScheduling::dataReceive()
 	while (mLenDone > 0)
 	{
 		success = byteProcess((uint8_t)*mpBuf, curTimeMs);
+		flightStatesCheck();
 
 		++mpBuf;
 		--mLenDone;
@@ -455,8 +963,8 @@ Success SingleWireScheduling::dataReceive()
 
 	//procInfLog("diff: %u <=> %u", diffMs, dTimeoutTargetInitMs);
 
-	if ((!uartVirtual && diffMs > dTimeoutTargetInitMs) ||
-		(uartVirtual && uartVirtualTimeout))
+	if ((!mUart.virtualEnabled && diffMs > dTimeoutTargetInitMs) ||
+		(mUart.virtualEnabled && mUart.virtualTimeout))
 	{
 		mFragments.clear();
 		mStateSwt = StSwtContentRcvWait;
@@ -464,7 +972,11 @@ Success SingleWireScheduling::dataReceive()
 		return SwtErrRcvNoTarget;
 	}
 
-	mLenDone = uartRead(mRefUart, mBufRcv, sizeof(mBufRcv));
+	{
+		Guard lock(mMtxUart);
+		mLenDone = uartRead(mUart, mBufRcv, sizeof(mBufRcv));
+	}
+
 	if (!mLenDone)
 		return Pending;
 
@@ -479,6 +991,16 @@ Success SingleWireScheduling::dataReceive()
 	mpBuf = mBufRcv;
 
 	mStartMs = millis();
+	mRcvdUs = usMonotonic();
+
+	flightRecord(FlightUartRx, mIdFlight, mBufRcv, mLenDone);
+	tapRecord('R', mBufRcv, mLenDone);
+
+	if (mPollPending)
+	{
+		mHistTurnaroundPoll.add(mRcvdUs - mStartPollUs);
+		mPollPending = false;
+	}
 
 	return Pending;
 }
@@ -501,6 +1023,11 @@ Success SingleWireScheduling::byteProcess(uint8_t ch, uint32_t curTimeMs)
 			//procWrnLog("received IdContentNone");
 			++mCntContentNoneRcvd;
 
+			cntInc(mMetrics.bytesContent[IdxContentNone]);
+			cntInc(mMetrics.framesContent[IdxContentNone]);
+
+			flightRecord(FlightFrameEnd, mIdFlight, ch);
+
 			responseReset();
 
 			return Positive;
@@ -511,6 +1038,9 @@ Success SingleWireScheduling::byteProcess(uint8_t ch, uint32_t curTimeMs)
 
 		responseReset(ch);
 		mContentIgnore = false;
+		mFrameFirstUs = mRcvdUs;
+
+		flightRecord(FlightFrameStart, mIdFlight, ch);
 
 		if (ch != IdContentProc)
 		{
@@ -537,12 +1067,19 @@ Success SingleWireScheduling::byteProcess(uint8_t ch, uint32_t curTimeMs)
 
 		if (ch == IdContentCut)
 		{
+			flightRecord(FlightFrameCut, mIdFlight, mResp.idContent);
 			mStateSwt = StSwtContentRcvWait;
 			break;
 		}
 
 		if (ch == IdContentEnd)
 		{
+			cntInc(mMetrics.framesContent[idxContent(mResp.idContent)]);
+
+			flightRecord(FlightFrameEnd, mIdFlight, mResp.idContent);
+
+			mFrameLastUs = mRcvdUs;
+
 			if (!mContentIgnore)
 				fragmentFinish();
 
@@ -559,6 +1096,8 @@ Success SingleWireScheduling::byteProcess(uint8_t ch, uint32_t curTimeMs)
 			ch == cKeyCr ||
 			ch == cKeyLf)
 		{
+			cntInc(mMetrics.bytesContent[idxContent(mResp.idContent)]);
+
 			if (!mContentIgnore)
 				fragmentAppend(ch);
 			break;
@@ -567,6 +1106,10 @@ Success SingleWireScheduling::byteProcess(uint8_t ch, uint32_t curTimeMs)
 		if (!mContentIgnore)
 			fragmentDelete();
 
+		cntInc(mMetrics.errProtocol);
+
+		flightRecord(FlightFrameErr, mIdFlight, ch);
+
 		mStateSwt = StSwtContentRcvWait;
 		return SwtErrRcvProtocol;
 
@@ -578,52 +1121,99 @@ Success SingleWireScheduling::byteProcess(uint8_t ch, uint32_t curTimeMs)
 	return Pending;
 }
 
-Success SingleWireScheduling::shutdown()
+void SingleWireScheduling::tapActiveSet(bool active)
 {
-
-	if (mRefUart != RefDeviceUartInvalid)
-	{
-		devUartDeInit(mRefUart);
-		refUart = mRefUart;
-	}
-
-	return Positive;
+	mTapActive.store(active, memory_order_relaxed);
 }
 
-void SingleWireScheduling::fragmentAppend(uint8_t ch)
+/*
+ * The only copy of tapped bytes. Buffers circulate
+ * between ring and consumer => No allocations in
+ * steady state
+ */
+void SingleWireScheduling::tapRecord(uint8_t dir, const void *pData, size_t len)
 {
-	if (!ch)
+	uint64_t timeUs;
+	uint32_t lenData = len;
+
+	if (!mTapActive.load(memory_order_relaxed))
 		return;
 
-	uint8_t idContent = mResp.idContent;
-	bool fragmentFound =
-			mFragments.find(idContent) != mFragments.end();
+	timeUs = usMonotonic();
 
-	if (!fragmentFound)
-	{
-		mFragments[idContent] = string(1, ch);
-		return;
-	}
+	mBufTap.clear();
+	mBufTap.push_back(dir);
 
-	const string &str = mFragments[idContent];
+	for (size_t i = 0; i < sizeof(timeUs); ++i)
+		mBufTap.push_back((char)(timeUs >> (8 * i)));
+
+	for (size_t i = 0; i < sizeof(lenData); ++i)
+		mBufTap.push_back((char)(lenData >> (8 * i)));
+
+	mBufTap.append((const char *)pData, len);
+
+	if (!rgTap.commit(std::move(mBufTap)))
+	{
+		++mCntTapDropped;
+		return;
+	}
+
+	wakeupNotify();
+}
+
+// Cheap enough to be called for every byte
+void SingleWireScheduling::flightStatesCheck()
+{
+	if (mState != mStateFlight)
+	{
+		flightRecord(FlightState, mIdFlight, mState);
+		mStateFlight = mState;
+	}
+
+	if (mStateSwt != mStateSwtFlight)
+	{
+		flightRecord(FlightStateSwt, mIdFlight, mStateSwt);
+		mStateSwtFlight = mStateSwt;
+	}
+}
+
+Success SingleWireScheduling::shutdown()
+{
+	Guard lock(mMtxUart);
+
+	fdsWaitSet(mUart, false);
+	devUartWatchDeInit(mUart);
+	devUartDeInit(mUart);
+
+	return Positive;
+}
+
+void SingleWireScheduling::fragmentAppend(uint8_t ch)
+{
+	if (!ch)
+		return;
+
+	string &str = mFragments[mResp.idContent];
+
+	if (!str.size() && mResp.idContent == IdContentProc)
+		str = dContentProcPrefix;
 
 	if (str.size() > cSizeFragmentMax)
 		return;
 
-	mFragments[idContent] += string(1, ch);
+	str.push_back(ch);
 }
 
 void SingleWireScheduling::fragmentFinish()
 {
-	uint8_t idContent = mResp.idContent;
-	bool fragmentFound =
-			mFragments.find(idContent) != mFragments.end();
+	map<int, string>::iterator iter;
 
-	if (!fragmentFound)
+	iter = mFragments.find(mResp.idContent);
+	if (iter == mFragments.end())
 		return;
 
-	mResp.content = mFragments[idContent];
-	mFragments.erase(idContent);
+	mResp.content = std::move(iter->second);
+	mFragments.erase(iter);
 }
 
 void SingleWireScheduling::fragmentDelete()
@@ -638,6 +1228,47 @@ void SingleWireScheduling::fragmentDelete()
 	mFragments.erase(idContent);
 }
 
+bool SingleWireScheduling::targetInitRespCheck(const string &resp)
+{
+	size_t len = cRespTargetInit.size();
+
+	if (resp.compare(0, len, cRespTargetInit))
+		return false;
+
+	if (resp.size() > len && resp[len] != ' ')
+		return false;
+
+	Guard lock(mMtxIdFirmware);
+
+	if (resp.size() > len + 1)
+		mIdFirmware = resp.substr(len + 1);
+	else
+		mIdFirmware.clear();
+
+	return true;
+}
+
+string SingleWireScheduling::firmwareIdGet()
+{
+	Guard lock(mMtxIdFirmware);
+	return mIdFirmware;
+}
+
+void SingleWireScheduling::devUartOnlineSet(bool online)
+{
+	if (mDevUartIsOnline == online)
+		return;
+	mDevUartIsOnline = online;
+
+	cntInc(online ? mMetrics.uartOnline : mMetrics.uartOffline);
+}
+
+void SingleWireScheduling::queueDepthsUpdate()
+{
+	for (size_t i = 0; i < cNumPrioCmd; ++i)
+		mMetrics.depthQueueCmd[i].store(mRequestsCmd[i].size(), memory_order_relaxed);
+}
+
 void SingleWireScheduling::targetOnlineSet(bool online)
 {
 	mTargetIsOnline = online;
@@ -646,6 +1277,8 @@ void SingleWireScheduling::targetOnlineSet(bool online)
 		return;
 	mTargetIsOnlineOld = online;
 
+	cntInc(online ? mMetrics.targetOnline : mMetrics.targetOffline);
+
 	if (online)
 		return;
 
@@ -653,8 +1286,33 @@ void SingleWireScheduling::targetOnlineSet(bool online)
 		return;
 	mTargetIsOfflineMarked = true;
 
-	mContentProc += "\r\n[Target is offline]\r\n";
-	mContentProcChanged = true;
+	// Rare. Shared frames are immutable => New one
+	mpContentProc = std::make_shared<const string>(*mpContentProc + "\r\n[Target is offline]\r\n");
+	contentProcPublish();
+}
+
+void SingleWireScheduling::contentProcPublish()
+{
+	{
+		// Dispatcher only needs the latest tree
+		Guard lock(mMtxContentProc);
+		mpContentProcPending = mpContentProc;
+	}
+
+	wakeupNotify();
+}
+
+bool SingleWireScheduling::contentProcGet(ContentShared &pContent)
+{
+	Guard lock(mMtxContentProc);
+
+	if (!mpContentProcPending)
+		return false;
+
+	pContent = std::move(mpContentProcPending);
+	mpContentProcPending.reset();
+
+	return true;
 }
 
 void SingleWireScheduling::responseReset(uint8_t idContent)
@@ -672,14 +1330,35 @@ void SingleWireScheduling::processInfo(char *pBuf, char *pBufEnd)
 #if 1
 	dInfo("State SWT\t\t\t%s\n", SwtStateString[mStateSwt]);
 #endif
-	dInfo("Virtual UART mode\t\t%s\n", uartVirtualMode ? "uart" : "swart");
-	dInfo("Virtual UART\t\t%sabled\n", uartVirtual ? "En" : "Dis");
+	dInfo("Virtual UART mode\t\t%s\n", mUart.virtualMode ? "uart" : "swart");
+	dInfo("Virtual UART\t\t%sabled\n", mUart.virtualEnabled ? "En" : "Dis");
 	dInfo("UART: %s\t%sline\n",
-			env.deviceUart.c_str(),
+			mDeviceUart.c_str(),
 			mDevUartIsOnline ? "On" : "Off");
 	dInfo("Target\t\t\t%sline\n", mTargetIsOnline ? "On" : "Off");
+	dInfo("Firmware\t\t%s\n", firmwareIdGet().c_str());
 	dInfo("Bytes received\t\t%zu\n", mCntBytesRcvd);
 	dInfo("IdContentNone received\t%zu\n", mCntContentNoneRcvd);
+	dInfo("Poll delay\t\t%u [ms]\n", mDelayPollMs);
+	dInfo("Commands served\t\t%u / %u / %u\n",
+			mCntCmdServed[PrioSysHigh],
+			mCntCmdServed[PrioUser],
+			mCntCmdServed[PrioSysLow]);
+	dInfo("Shares\t\t\t%u / %u / %u\n",
+			mSharesPrio[PrioSysHigh].load(),
+			mSharesPrio[PrioUser].load(),
+			mSharesPrio[PrioSysLow].load());
+	dInfo("Commands expired\t%u\n", mCntCmdExpired);
+	dInfo("Cache hits / coalesced\t%u / %u\n", mCntCacheHits, mCntCacheCoalesced);
+	dInfo("Log entries dropped\t%zu\n", mCntEntriesLogDropped);
+	if (mTapActive.load(memory_order_relaxed))
+		dInfo("Tap chunks dropped\t%zu\n", mCntTapDropped);
+
+	histogramInfoPrint(pBuf, pBufEnd, "Queue sys high", mHistQueueCmd[PrioSysHigh]);
+	histogramInfoPrint(pBuf, pBufEnd, "Queue user", mHistQueueCmd[PrioUser]);
+	histogramInfoPrint(pBuf, pBufEnd, "Queue sys low", mHistQueueCmd[PrioSysLow]);
+	histogramInfoPrint(pBuf, pBufEnd, "Command round trip", mHistRoundTripCmd);
+	histogramInfoPrint(pBuf, pBufEnd, "Poll turnaround", mHistTurnaroundPoll);
 #if 0
 	dInfo("Fragments\n");
 
@@ -697,16 +1376,16 @@ void SingleWireScheduling::processInfo(char *pBuf, char *pBufEnd)
 #endif
 #if 0
 	dInfo("Command requests\n");
-	dInfo("ID next\t\t\t%u\n", idReqCmdNext);
+	dInfo("ID next\t\t\t%u\n", mIdReqCmdNext);
 
 	list<CommandReqResp> *pList;
 	list<CommandReqResp>::iterator iter;
 	uint32_t curTimeMs = millis();
 	uint32_t diffMs;
 
-	for (size_t i = 0; i < 3; ++i)
+	for (size_t i = 0; i < cNumPrioCmd; ++i)
 	{
-		pList = &requestsCmd[i];
+		pList = &mRequestsCmd[i];
 
 		dInfo("Priority %zu\n", i);
 
@@ -732,8 +1411,8 @@ void SingleWireScheduling::processInfo(char *pBuf, char *pBufEnd)
 	}
 
 	dInfo("Command responses\n");
-	iter = responsesCmd.begin();
-	for (; iter != responsesCmd.end(); ++iter)
+	iter = mResponsesCmd.begin();
+	for (; iter != mResponsesCmd.end(); ++iter)
 	{
 		diffMs = curTimeMs - iter->startMs;
 
@@ -747,36 +1426,208 @@ void SingleWireScheduling::processInfo(char *pBuf, char *pBufEnd)
 	}
 
 #endif
+	dProfileInfo(mProfTick);
+	dAllocInfo(mAllocTick);
+}
+
+void SingleWireScheduling::metricsAdd(MetricFamilies &families, const string &labels) const
+{
+	string labelsSub;
+
+	for (size_t i = 0; i < cNumIdxContent; ++i)
+	{
+		labelsSub = labels + ",content=\"" + cNamesIdxContent[i] + "\"";
+
+		metricAdd(families, "codeorb_swt_bytes_total", MetricCounter,
+				"Bytes transferred on the single wire per content ID",
+				labelsSub, cntGet(mMetrics.bytesContent[i]));
+		metricAdd(families, "codeorb_swt_frames_total", MetricCounter,
+				"Frames transferred on the single wire per content ID",
+				labelsSub, cntGet(mMetrics.framesContent[i]));
+	}
+
+	metricAdd(families, "codeorb_swt_errors_protocol_total", MetricCounter,
+			"Protocol errors on the single wire",
+			labels, cntGet(mMetrics.errProtocol));
+
+	metricAdd(families, "codeorb_uart_transitions_total", MetricCounter,
+			"UART device online/offline transitions",
+			labels + ",to=\"online\"", cntGet(mMetrics.uartOnline));
+	metricAdd(families, "codeorb_uart_transitions_total", MetricCounter,
+			"UART device online/offline transitions",
+			labels + ",to=\"offline\"", cntGet(mMetrics.uartOffline));
+
+	metricAdd(families, "codeorb_target_transitions_total", MetricCounter,
+			"Target online/offline transitions",
+			labels + ",to=\"online\"", cntGet(mMetrics.targetOnline));
+	metricAdd(families, "codeorb_target_transitions_total", MetricCounter,
+			"Target online/offline transitions",
+			labels + ",to=\"offline\"", cntGet(mMetrics.targetOffline));
+
+	metricAdd(families, "codeorb_uart_online", MetricGauge,
+			"UART device is online",
+			labels, mDevUartIsOnline ? 1 : 0);
+	metricAdd(families, "codeorb_target_online", MetricGauge,
+			"Target is online",
+			labels, mTargetIsOnline ? 1 : 0);
+
+	for (size_t i = 0; i < cNumPrioCmd; ++i)
+	{
+		metricAdd(families, "codeorb_cmd_queue_depth", MetricGauge,
+				"Queued commands per priority",
+				labels + ",prio=\"" + cNamesPrioCmd[i] + "\"",
+				cntGet(mMetrics.depthQueueCmd[i]));
+	}
 }
 
 /* static functions */
 
-bool SingleWireScheduling::commandSend(const string &cmd, uint32_t &idReq, PrioCmd prio)
+bool SingleWireScheduling::commandSend(const string &cmd, uint32_t &idReq,
+					PrioCmd prio, uint32_t idSession, uint32_t timeoutMs)
 {
-	// optional mutex
+	cmdResponsesFetch();
 
-	list<CommandReqResp> *pList = &requestsCmd[prio];
+	if (mResponsesCmd.size() > cNumRequestsCmdMax)
+		return false;
 
-	if (pList->size() > cNumRequestsCmdMax)
+	// Queued and still in the ring. Reject now instead of a silent timeout
+	if (cntGet(mMetrics.depthQueueCmd[prio]) + mRingReqCmd.size() >= cNumRequestsCmdMax)
 		return false;
 
-	if (responsesCmd.size() > cNumRequestsCmdMax)
+	uint32_t curTimeMs = millis();
+
+	if (mCacheCmd.size() && cmdCacheServe(cmd, idReq, curTimeMs))
+		return true;
+
+	uint32_t id = mIdReqCmdNext;
+	CommandReqResp req(cmd, id, curTimeMs, prio);
+
+	req.startUs = usMonotonic();
+	req.idSession = idSession;
+	req.deadlineMs = req.startMs + timeoutMs;
+
+	if (!mRingReqCmd.commit(std::move(req)))
+		return false;
+
+	// Scheduler may be sleeping in a poll delay
+	wakeupNotify();
+
+	idReq = id;
+	++mIdReqCmdNext;
+
+	map<string, CmdCacheEntry>::iterator iter = mCacheCmd.find(cmd);
+	if (iter == mCacheCmd.end())
+		return true;
+
+	CmdCacheEntry &entry = iter->second;
+
+	entry.inFlight = true;
+	entry.idReqInFlight = id;
+	entry.startMs = curTimeMs;
+	entry.idsReqWaiting.clear();
+
+	return true;
+}
+
+void SingleWireScheduling::cacheTtlSet(const string &cmd, uint32_t ttlMs)
+{
+	if (!ttlMs)
+	{
+		mCacheCmd.erase(cmd);
+		return;
+	}
+
+	map<string, CmdCacheEntry>::iterator iter = mCacheCmd.find(cmd);
+	if (iter != mCacheCmd.end())
+	{
+		iter->second.ttlMs = ttlMs;
+		return;
+	}
+
+	CmdCacheEntry &entry = mCacheCmd[cmd];
+
+	entry.ttlMs = ttlMs;
+	entry.rcvdMs = 0;
+	entry.valid = false;
+	entry.inFlight = false;
+	entry.idReqInFlight = 0;
+	entry.startMs = 0;
+}
+
+/*
+ * Either answers from the cache or attaches to the
+ * identical request already in flight. In both cases
+ * the caller gets its own request ID
+ */
+bool SingleWireScheduling::cmdCacheServe(const string &cmd, uint32_t &idReq, uint32_t curTimeMs)
+{
+	map<string, CmdCacheEntry>::iterator iter = mCacheCmd.find(cmd);
+	if (iter == mCacheCmd.end())
 		return false;
 
-	idReq = idReqCmdNext;
-	++idReqCmdNext;
+	CmdCacheEntry &entry = iter->second;
+
+	if (entry.valid && curTimeMs - entry.rcvdMs < entry.ttlMs)
+	{
+		idReq = mIdReqCmdNext++;
+		mResponsesCmd.push_back(CommandReqResp(entry.resp, idReq, curTimeMs));
+		++mCntCacheHits;
+
+		return true;
+	}
+
+	entry.valid = false;
+
+	// Request may have been dropped by the scheduler
+	if (entry.inFlight && curTimeMs - entry.startMs >= cTimeoutCmdReq)
+		entry.inFlight = false;
+
+	if (!entry.inFlight)
+		return false;
 
-	pList->emplace_back(cmd, idReq, millis());
+	idReq = mIdReqCmdNext++;
+	entry.idsReqWaiting.push_back(idReq);
+	++mCntCacheCoalesced;
 
 	return true;
 }
 
+void SingleWireScheduling::cmdCacheFill(const CommandReqResp &resp)
+{
+	map<string, CmdCacheEntry>::iterator iter;
+	list<uint32_t>::iterator iterId;
+
+	iter = mCacheCmd.begin();
+	for (; iter != mCacheCmd.end(); ++iter)
+	{
+		CmdCacheEntry &entry = iter->second;
+
+		if (!entry.inFlight || entry.idReqInFlight != resp.idReq)
+			continue;
+
+		entry.resp = resp.str;
+		entry.rcvdMs = resp.startMs;
+		entry.valid = true;
+		entry.inFlight = false;
+
+		iterId = entry.idsReqWaiting.begin();
+		for (; iterId != entry.idsReqWaiting.end(); ++iterId)
+			mResponsesCmd.push_back(CommandReqResp(resp.str, *iterId, resp.startMs));
+
+		entry.idsReqWaiting.clear();
+
+		return;
+	}
+}
+
 bool SingleWireScheduling::commandResponseGet(uint32_t idReq, string &resp)
 {
 	list<CommandReqResp>::iterator iter;
 
-	iter = responsesCmd.begin();
-	while (iter != responsesCmd.end())
+	cmdResponsesFetch();
+
+	iter = mResponsesCmd.begin();
+	while (iter != mResponsesCmd.end())
 	{
 		if (iter->idReq != idReq)
 		{
@@ -785,7 +1636,7 @@ bool SingleWireScheduling::commandResponseGet(uint32_t idReq, string &resp)
 		}
 
 		resp = iter->str;
-		iter = responsesCmd.erase(iter);
+		iter = mResponsesCmd.erase(iter);
 
 		return true;
 	}
@@ -793,6 +1644,103 @@ bool SingleWireScheduling::commandResponseGet(uint32_t idReq, string &resp)
 	return false;
 }
 
+uint32_t SingleWireScheduling::sessionIdCreate()
+{
+	// ID 0 is the anonymous session
+	if (!idSessionNext)
+		++idSessionNext;
+
+	return idSessionNext++;
+}
+
+bool passBefore(uint32_t passA, uint32_t passB)
+{
+	return (int32_t)(passA - passB) < 0;
+}
+
+bool deadlinePassed(uint32_t deadlineMs, uint32_t curTimeMs)
+{
+	return (int32_t)(curTimeMs - deadlineMs) >= 0;
+}
+
+size_t idxContent(uint8_t idContent)
+{
+	if (idContent == IdContentProc) return IdxContentProc;
+	if (idContent == IdContentLog) return IdxContentLog;
+	if (idContent == IdContentCmd) return IdxContentCmd;
+
+	return IdxContentNone;
+}
+
+void fdsWaitSet(DeviceUart &dev, bool wait)
+{
+#if defined(__unix__) && !CONFIG_PROC_HAVE_DRIVERS
+	if (wait)
+	{
+		wakeupFdAdd(dev.ref);
+		wakeupFdAdd(dev.fdWatch);
+		return;
+	}
+
+	wakeupFdRemove(dev.ref);
+	wakeupFdRemove(dev.fdWatch);
+#else
+	(void)dev;
+	(void)wait;
+#endif
+}
+
+SingleWireScheduling *SingleWireScheduling::ctrlSelected()
+{
+	if (idxInstanceSel >= instances.size())
+		return NULL;
+
+	return instances[idxInstanceSel];
+}
+
+void SingleWireScheduling::cmdTargetSelect(char *pArgs, char *pBuf, char *pBufEnd)
+{
+	if (pArgs && *pArgs)
+	{
+		size_t idx = strtoul(pArgs, NULL, 10);
+
+		if (idx >= instances.size())
+		{
+			dInfo("Target index out of range: %zu", idx);
+			return;
+		}
+
+		idxInstanceSel = idx;
+	}
+
+	for (size_t i = 0; i < instances.size(); ++i)
+	{
+		dInfo("%c %zu: %s\n",
+				i == idxInstanceSel ? '*' : ' ',
+				i, instances[i]->mDeviceUart.c_str());
+	}
+}
+
+void SingleWireScheduling::cmdLatencyReset(char *pArgs, char *pBuf, char *pBufEnd)
+{
+	(void)pArgs;
+	SingleWireScheduling *pCtrl = ctrlSelected();
+
+	if (!pCtrl)
+	{
+		dInfo("No target selected");
+		return;
+	}
+
+	for (size_t i = 0; i < cNumPrioCmd; ++i)
+		pCtrl->mHistQueueCmd[i].reset();
+
+	pCtrl->mHistRoundTripCmd.reset();
+	pCtrl->mHistTurnaroundPoll.reset();
+
+	dInfo("Latency histograms reset: %s\n", pCtrl->mDeviceUart.c_str());
+}
+
 void SingleWireScheduling::cmdCtrlManualToggle(char *pArgs, char *pBuf, char *pBufEnd)
 {
 	(void)pArgs;
@@ -833,10 +1781,20 @@ void SingleWireScheduling::cmdDataUartRead(char *pArgs, char *pBuf, char *pBufEn
 		return;
 	}
 
+	SingleWireScheduling *pCtrl = ctrlSelected();
 	ssize_t lenDone;
 	char buf[55];
 
-	lenDone = uartRead(refUart, buf, sizeof(buf));
+	if (!pCtrl)
+	{
+		dInfo("No target selected");
+		return;
+	}
+
+	{
+		Guard lock(pCtrl->mMtxUart);
+		lenDone = uartRead(pCtrl->mUart, buf, sizeof(buf));
+	}
 	if (!lenDone)
 	{
 		dInfo("No data");
@@ -857,36 +1815,76 @@ void SingleWireScheduling::cmdDataUartRead(char *pArgs, char *pBuf, char *pBufEn
 
 void SingleWireScheduling::cmdModeUartVirtSet(char *pArgs, char *pBuf, char *pBufEnd)
 {
+	SingleWireScheduling *pCtrl = ctrlSelected();
+
+	if (!pCtrl)
+	{
+		dInfo("No target selected");
+		return;
+	}
+
+	DeviceUart &dev = pCtrl->mUart;
+
 	if (pArgs && *pArgs == 'u')
-		uartVirtualMode = 1;
+		dev.virtualMode = 1;
 	else
-		uartVirtualMode = 0;
+		dev.virtualMode = 0;
 
-	dInfo("Virtual UART mode: %s", uartVirtualMode ? "uart" : "swart");
+	dInfo("Virtual UART mode: %s", dev.virtualMode ? "uart" : "swart");
 }
 
 void SingleWireScheduling::cmdUartVirtToggle(char *pArgs, char *pBuf, char *pBufEnd)
 {
 	(void)pArgs;
 
-	uartVirtual ^= 1;
-	dInfo("Virtual UART %sabled", uartVirtual ? "en" : "dis");
+	SingleWireScheduling *pCtrl = ctrlSelected();
+
+	if (!pCtrl)
+	{
+		dInfo("No target selected");
+		return;
+	}
+
+	DeviceUart &dev = pCtrl->mUart;
+
+	dev.virtualEnabled ^= 1;
+	dInfo("Virtual UART %sabled", dev.virtualEnabled ? "en" : "dis");
 }
 
 void SingleWireScheduling::cmdMountedUartVirtToggle(char *pArgs, char *pBuf, char *pBufEnd)
 {
 	(void)pArgs;
 
-	uartVirtualMounted ^= 1;
-	dInfo("Virtual UART %smounted", uartVirtualMounted ? "" : "un");
+	SingleWireScheduling *pCtrl = ctrlSelected();
+
+	if (!pCtrl)
+	{
+		dInfo("No target selected");
+		return;
+	}
+
+	DeviceUart &dev = pCtrl->mUart;
+
+	dev.virtualMounted ^= 1;
+	dInfo("Virtual UART %smounted", dev.virtualMounted ? "" : "un");
 }
 
 void SingleWireScheduling::cmdTimeoutUartVirtToggle(char *pArgs, char *pBuf, char *pBufEnd)
 {
 	(void)pArgs;
 
-	uartVirtualTimeout ^= 1;
-	dInfo("Virtual UART timeout %s", uartVirtualTimeout ? "set" : "cleared");
+	SingleWireScheduling *pCtrl = ctrlSelected();
+
+	if (!pCtrl)
+	{
+		dInfo("No target selected");
+		return;
+	}
+
+	DeviceUart &dev = pCtrl->mUart;
+
+	dev.virtualTimeout ^= 1;
+	dInfo("Virtual UART timeout %s", dev.virtualTimeout ? "set" : "cleared");
 }
 
 void SingleWireScheduling::cmdDataUartRcv(char *pArgs, char *pBuf, char *pBufEnd)
@@ -922,8 +1920,17 @@ void SingleWireScheduling::dataUartSend(char *pArgs, char *pBuf, char *pBufEnd,
 	if (str == "cr")       str = "0D";
 	if (str == "lf")       str = "0A";
 
+	SingleWireScheduling *pCtrl = ctrlSelected();
+
+	if (!pCtrl)
+	{
+		dInfo("No target selected");
+		return;
+	}
+
 	vector<char> vData = toHex(str);
-	pFctSend(refUart, vData.data(), vData.size());
+	Guard lock(pCtrl->mMtxUart);
+	pFctSend(pCtrl->mUart, vData.data(), vData.size());
 
 	dInfo("Data moved");
 }
@@ -936,17 +1943,36 @@ void SingleWireScheduling::strUartSend(char *pArgs, char *pBuf, char *pBufEnd, F
 		return;
 	}
 
-	pFctSend(refUart, pArgs, strlen(pArgs));
+	SingleWireScheduling *pCtrl = ctrlSelected();
+
+	if (!pCtrl)
+	{
+		dInfo("No target selected");
+		return;
+	}
+
+	{
+		Guard lock(pCtrl->mMtxUart);
+		pFctSend(pCtrl->mUart, pArgs, strlen(pArgs));
+	}
+
 	dInfo("String moved");
 }
 
 // TEMP
 void SingleWireScheduling::cmdCommandSend(char *pArgs, char *pBuf, char *pBufEnd)
 {
+	SingleWireScheduling *pCtrl = ctrlSelected();
 	uint32_t idReq;
 	bool ok;
 
-	ok = SingleWireScheduling::commandSend(pArgs, idReq);
+	if (!pCtrl)
+	{
+		dInfo("No target selected");
+		return;
+	}
+
+	ok = pCtrl->commandSend(pArgs, idReq);
 	if (!ok)
 	{
 		dInfo("Could not send command: %s", pArgs);
@@ -955,5 +1981,106 @@ void SingleWireScheduling::cmdCommandSend(char *pArgs, char *pBuf, char *pBufEnd
 
 	dInfo("Command sent: %s", pArgs);
 }
+
+void SingleWireScheduling::cmdCacheSet(char *pArgs, char *pBuf, char *pBufEnd)
+{
+	SingleWireScheduling *pCtrl = ctrlSelected();
+	uint32_t ttlMs;
+	char *pEnd;
+
+	if (!pCtrl)
+	{
+		dInfo("No target selected");
+		return;
+	}
+
+	if (pArgs && *pArgs)
+	{
+		ttlMs = strtoul(pArgs, &pEnd, 10);
+
+		while (*pEnd == ' ')
+			++pEnd;
+
+		if (pEnd == pArgs || !*pEnd)
+		{
+			dInfo("Usage: cmdCacheSet <ttlMs> <command>. ttlMs = 0 => Disable");
+			return;
+		}
+
+		pCtrl->cacheTtlSet(pEnd, ttlMs);
+	}
+
+	map<string, CmdCacheEntry>::const_iterator iter;
+
+	if (!pCtrl->mCacheCmd.size())
+	{
+		dInfo("No cached commands");
+		return;
+	}
+
+	iter = pCtrl->mCacheCmd.begin();
+	for (; iter != pCtrl->mCacheCmd.end(); ++iter)
+		dInfo("%-24s %u [ms]\n", iter->first.c_str(), iter->second.ttlMs);
+}
+
+void SingleWireScheduling::cmdFlightDump(char *pArgs, char *pBuf, char *pBufEnd)
+{
+	(void)pArgs;
+	char nameFile[64];
+	size_t cntEvents;
+	int fd;
+
+	snprintf(nameFile, sizeof(nameFile), "%lld_%s_flight.txt",
+				(long long)time(NULL), dAppName);
+
+	fd = open(nameFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+	{
+		dInfo("Could not open %s\n", nameFile);
+		return;
+	}
+
+	cntEvents = flightDump(fd);
+	close(fd);
+
+	dInfo("Flight recorder: %zu events written to %s\n", cntEvents, nameFile);
+}
+
+void SingleWireScheduling::cmdSharesSet(char *pArgs, char *pBuf, char *pBufEnd)
+{
+	SingleWireScheduling *pCtrl = ctrlSelected();
+	uint32_t shares[cNumPrioCmd];
+	char *pEnd;
+
+	if (!pCtrl)
+	{
+		dInfo("No target selected");
+		return;
+	}
+
+	if (pArgs && *pArgs)
+	{
+		for (size_t i = 0; i < cNumPrioCmd; ++i)
+		{
+			shares[i] = strtoul(pArgs, &pEnd, 10);
+
+			if (pEnd == pArgs || !shares[i])
+			{
+				dInfo("Shares must be three numbers greater than zero");
+				return;
+			}
+
+			pArgs = pEnd;
+		}
+
+		for (size_t i = 0; i < cNumPrioCmd; ++i)
+			pCtrl->mSharesPrio[i].store(shares[i], memory_order_relaxed);
+	}
+
+	dInfo("Shares: %u / %u / %u",
+			pCtrl->mSharesPrio[PrioSysHigh].load(),
+			pCtrl->mSharesPrio[PrioUser].load(),
+			pCtrl->mSharesPrio[PrioSysLow].load());
+}
 // TEMP end
 
@@ -28,10 +28,18 @@
 
 #include <string>
 #include <map>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <memory>
 
 #include "Processing.h"
-#include "Pipe.h"
+#include "LibProfiling.h"
+#include "LibAllocTracking.h"
+#include "RingSpsc.h"
 #include "LibUart.h"
+#include "LibMetrics.h"
+#include "LibFlightRec.h"
 
 enum SwtContentId
 {
@@ -53,6 +61,69 @@ enum PrioCmd
 	PrioSysHigh = 0,
 	PrioUser,
 	PrioSysLow,
+	cNumPrioCmd,
+};
+
+enum SwtIdxContent
+{
+	IdxContentNone = 0,
+	IdxContentProc,
+	IdxContentLog,
+	IdxContentCmd,
+	IdxContentCmdOut,
+	cNumIdxContent,
+};
+
+// Written by the scheduler thread only
+struct SwtMetrics
+{
+	SwtMetrics();
+
+	Counter bytesContent[cNumIdxContent];
+	Counter framesContent[cNumIdxContent];
+	Counter errProtocol;
+	Counter uartOnline;
+	Counter uartOffline;
+	Counter targetOnline;
+	Counter targetOffline;
+	Counter depthQueueCmd[cNumPrioCmd];
+
+private:
+
+	SwtMetrics(const SwtMetrics &) = delete;
+	SwtMetrics &operator=(const SwtMetrics &) = delete;
+
+};
+
+/*
+ * Finished frames are immutable and shared. Handed
+ * from the scheduler to the dispatcher and its peers
+ * without copying the content
+ */
+typedef std::shared_ptr<const std::string> ContentShared;
+
+/*
+ * Process tree frames start with a screen clear. It is
+ * built in while receiving => Peers get them as they are
+ */
+#define dContentProcPrefix "\033[2J\033[H"
+const size_t cLenContentProcPrefix = sizeof(dContentProcPrefix) - 1;
+
+/*
+ * Log entry with the host times [us] of the
+ * first and last byte of its frame on the wire
+ */
+struct EntryLog
+{
+	EntryLog()
+		: str()
+		, firstUs(0)
+		, lastUs(0)
+	{}
+
+	std::string str;
+	uint64_t firstUs;
+	uint64_t lastUs;
 };
 
 struct SingleWireResponse
@@ -61,51 +132,127 @@ struct SingleWireResponse
 	std::string content;
 };
 
-typedef ssize_t (*FuncUartSend)(RefDeviceUart refUart, const void *pBuf, size_t lenReq);
+typedef ssize_t (*FuncUartSend)(DeviceUart &dev, const void *pBuf, size_t lenReq);
 
 struct CommandReqResp
 {
-	CommandReqResp(std::string cmd, uint32_t id, uint32_t start)
+	CommandReqResp()
+		: str()
+		, idReq(0)
+		, startMs(0)
+		, startUs(0)
+		, prio(PrioUser)
+		, idSession(0)
+		, deadlineMs(0)
+		, cntSent(0)
+	{}
+
+	CommandReqResp(std::string cmd, uint32_t id, uint32_t start, PrioCmd p = PrioUser)
 		: str(std::move(cmd))
 		, idReq(id)
 		, startMs(start)
+		, startUs(0)
+		, prio(p)
+		, idSession(0)
+		, deadlineMs(0)
+		, cntSent(0)
 	{}
 
 	std::string str;
 	uint32_t idReq;
 	uint32_t startMs;
+	uint64_t startUs;
+	PrioCmd prio;
+	uint32_t idSession;
+	uint32_t deadlineMs;
+	uint8_t cntSent;
 };
 
+typedef std::list<CommandReqResp>::iterator CmdIter;
+
+// Dispatcher thread only
+struct CmdCacheEntry
+{
+	uint32_t ttlMs;
+	std::string resp;
+	uint32_t rcvdMs;
+	bool valid;
+	bool inFlight;
+	uint32_t idReqInFlight;
+	uint32_t startMs;
+	std::list<uint32_t> idsReqWaiting;
+};
+
+const uint32_t cTimeoutCmdReq = 5500;
+
 class SingleWireScheduling : public Processing
 {
 
 public:
 
-	static SingleWireScheduling *create()
+	static SingleWireScheduling *create(const std::string &deviceUart)
 	{
-		return new dNoThrow SingleWireScheduling;
+		return new dNoThrow SingleWireScheduling(deviceUart);
 	}
 
-	bool mDevUartIsOnline;
-	bool mTargetIsOnline;
+	std::atomic<bool> mDevUartIsOnline;
+	std::atomic<bool> mTargetIsOnline;
+
+	/*
+	 * The scheduler runs on its own driver thread.
+	 * Content is handed over to the dispatcher thread
+	 * through these rings. Consumer: Dispatcher only
+	 */
+	RingSpsc<EntryLog, 256> rgEntriesLog;
 
-	bool contentProcChanged();
-	std::string mContentProc;
+	// Latest process tree wins. Consumer: Dispatcher only
+	bool contentProcGet(ContentShared &pContent);
 
-	Pipe<std::string> ppEntriesLog;
+	/*
+	 * Raw UART tap. Only filled while the dispatcher
+	 * reports connected tap clients. Each chunk:
+	 * - u8 direction: 'R' => Read, 'T' => Sent
+	 * - u64 time [us], little endian
+	 * - u32 length of data, little endian
+	 * - data
+	 */
+	RingSpsc<std::string, 64> rgTap;
+	void tapActiveSet(bool active);
 
-	static bool commandSend(const std::string &cmd,
+	/*
+	 * Must be called from the dispatcher thread only.
+	 * Requests still queued after timeoutMs are dropped.
+	 * Sessions of the same priority are served in turns
+	 */
+	bool commandSend(const std::string &cmd,
 					uint32_t &idReq,
-					PrioCmd prio = PrioUser);
-	static bool commandResponseGet(uint32_t idReq, std::string &resp);
+					PrioCmd prio = PrioUser,
+					uint32_t idSession = 0,
+					uint32_t timeoutMs = cTimeoutCmdReq);
+	bool commandResponseGet(uint32_t idReq, std::string &resp);
+
+	/*
+	 * Opt-in. Results of cmd are reused for ttlMs.
+	 * Identical requests while one is on the wire
+	 * share its response. ttlMs = 0 => Disable
+	 */
+	void cacheTtlSet(const std::string &cmd, uint32_t ttlMs);
+
+	void metricsAdd(MetricFamilies &families, const std::string &labels) const;
+
+	static uint32_t sessionIdCreate();
+
+	// Reported by the target during initialization. May be empty
+	std::string firmwareIdGet();
 
 protected:
 
-	SingleWireScheduling();
-	virtual ~SingleWireScheduling() {}
+	SingleWireScheduling(const std::string &deviceUart);
+	virtual ~SingleWireScheduling();
 
 private:
 
+	SingleWireScheduling() = delete;
 	SingleWireScheduling(const SingleWireScheduling &) = delete;
 	SingleWireScheduling &operator=(const SingleWireScheduling &) = delete;
 
@@ -119,11 +266,26 @@ private:
 	Success shutdown();
 	void processInfo(char *pBuf, char *pBufEnd);
 
-	bool cmdQueueCheck();
-	void cmdResponseReceived(const std::string &resp);
+	bool cmdQueueCheck(uint32_t curTimeMs);
+	bool cmdNextSelect(uint32_t curTimeMs, size_t &prio, CmdIter &iterSel);
+	CmdIter cmdSessionSelect(std::list<CommandReqResp> &requests, uint32_t idSessionLast);
+	void cmdRequestsExpire(uint32_t curTimeMs);
+	void cmdResponseReceived(std::string &resp);
 	void commandsCheck(uint32_t curTimeMs);
+	void cmdRequestsFetch();
+	void cmdResponsesFetch();
 	void cmdResponsesClear(uint32_t curTimeMs);
+	bool cmdCacheServe(const std::string &cmd, uint32_t &idReq, uint32_t curTimeMs);
+	void cmdCacheFill(const CommandReqResp &resp);
+	void contentProcPublish();
+	void devUartOnlineSet(bool online = true);
+	void queueDepthsUpdate();
+	void wakeupSchedule(uint32_t curTimeMs);
+	bool pollDelayed(uint32_t curTimeMs);
+	void pollDelayUpdate(bool contentNone);
 	void cmdSend(const std::string &cmd);
+	void flightStatesCheck();
+	void tapRecord(uint8_t dir, const void *pData, size_t len);
 	void dataRequest();
 	Success dataReceive();
 	Success byteProcess(uint8_t ch, uint32_t curTimeMs);
@@ -131,30 +293,95 @@ private:
 	void fragmentFinish();
 	void fragmentDelete();
 
+	bool targetInitRespCheck(const std::string &resp);
 	void targetOnlineSet(bool online = true);
 	void responseReset(uint8_t idContent = IdContentNone);
 
 	/* member variables */
 	uint32_t mStateSwt;
+	uint32_t mStateFlight;
+	uint32_t mStateSwtFlight;
+	uint8_t mIdFlight;
 	uint32_t mStartMs;
-	RefDeviceUart mRefUart;
+	std::string mDeviceUart;
+	DeviceUart mUart;
+	/*
+	 * Taken around device I/O only. Never across the
+	 * hotplug poll. Debug commands use the device too
+	 */
+	std::mutex mMtxUart;
 	char mBufRcv[13];
 	char *mpBuf;
 	ssize_t mLenDone;
 	std::map<int, std::string> mFragments;
 	SingleWireResponse mResp;
-	bool mContentProcChanged;
+	ContentShared mpContentProc;
+	EntryLog mEntryLog;
+	uint64_t mRcvdUs;
+	uint64_t mFrameFirstUs;
+	uint64_t mFrameLastUs;
+	size_t mCntEntriesLogDropped;
+	std::atomic<bool> mTapActive;
+	std::string mBufTap;
+	size_t mCntTapDropped;
+	SwtMetrics mMetrics;
+	std::mutex mMtxIdFirmware;
+	std::mutex mMtxContentProc;
+	ContentShared mpContentProcPending;
+	std::string mIdFirmware;
 	size_t mCntBytesRcvd;
 	size_t mCntContentNoneRcvd;
 	uint32_t mLastProcTreeRcvdMs;
 	bool mTargetIsOnlineOld;
 	bool mTargetIsOfflineMarked;
 	bool mContentIgnore;
-	std::list<CommandReqResp> *mpListCmdCurrent;
-	uint8_t mCntDelayPrioLow;
+	CommandReqResp mCmdCurrent;
+	bool mCmdCurrentPending;
 	uint32_t mStartCmdMs;
-
+	uint32_t mCntStreakContentNone;
+	uint32_t mDelayPollMs;
+	uint32_t mPollDoneMs;
+	RingSpsc<CommandReqResp, 64> mRingReqCmd;
+	RingSpsc<CommandReqResp, 64> mRingRespCmd;
+
+	// Written by commands, read by the scheduler thread
+	std::atomic<uint32_t> mSharesPrio[cNumPrioCmd];
+
+	// Scheduler thread
+	std::list<CommandReqResp> mRequestsCmd[cNumPrioCmd];
+	uint32_t mPassPrio[cNumPrioCmd];
+	uint32_t mPassVirtual;
+	uint32_t mIdSessionLast[cNumPrioCmd];
+	uint32_t mCntCmdServed[cNumPrioCmd];
+	uint32_t mCntCmdExpired;
+
+	// Dispatcher thread
+	std::list<CommandReqResp> mResponsesCmd;
+	uint32_t mIdReqCmdNext;
+	std::map<std::string, CmdCacheEntry> mCacheCmd;
+	uint32_t mCntCacheHits;
+	uint32_t mCntCacheCoalesced;
+
+	// Latency in [us]
+	Histogram mHistQueueCmd[cNumPrioCmd];
+	Histogram mHistRoundTripCmd;
+	Histogram mHistTurnaroundPoll;
+	uint64_t mStartCmdUs;
+	uint64_t mStartPollUs;
+	bool mPollPending;
+
+#if CONFIG_APP_HAVE_PROFILING
+	ProfileTick mProfTick;
+#endif
+#if CONFIG_APP_HAVE_ALLOC_TRACKING
+	AllocStats mAllocTick;
+#endif
 	/* static functions */
+	static SingleWireScheduling *ctrlSelected();
+
+	// Targets
+	static void cmdTargetSelect(char *pArgs, char *pBuf, char *pBufEnd);
+	static void cmdLatencyReset(char *pArgs, char *pBuf, char *pBufEnd);
 
 	// Manual Control
 	static void cmdCtrlManualToggle(char *pArgs, char *pBuf, char *pBufEnd);
@@ -174,11 +401,15 @@ private:
 
 	// Commands
 	static void cmdCommandSend(char *pArgs, char *pBuf, char *pBufEnd);
+	static void cmdSharesSet(char *pArgs, char *pBuf, char *pBufEnd);
+	static void cmdCacheSet(char *pArgs, char *pBuf, char *pBufEnd);
+	static void cmdFlightDump(char *pArgs, char *pBuf, char *pBufEnd);
 
 	/* static variables */
-	static std::list<CommandReqResp> requestsCmd[3];
-	static std::list<CommandReqResp> responsesCmd;
-	static uint32_t idReqCmdNext;
+	static std::vector<SingleWireScheduling *> instances;
+	static size_t idxInstanceSel;
+	static bool cmdsRegistered;
+	static uint32_t idSessionNext;
 
 	/* constants */
 
@@ -30,20 +30,9 @@
 		gen(StKeyMain) \
 		gen(StKeyUnicode) \
 		gen(StKeyDrop1) \
-		gen(StKeyEscMain) \
-		gen(StKeyEscO) \
-		gen(StKeyEscBracket) \
-		gen(StKeyEsc1) \
-		gen(StKeyMod) \
-		gen(StKeyEsc2) \
-		gen(StKeyEsc3) \
-		gen(StKeyEscTilde) \
-		gen(StKeyIac) \
-		gen(StKeyIacWill) \
-		gen(StKeyIacWont) \
-		gen(StKeyIacDo) \
-		gen(StKeyIacDont) \
-		gen(StKeyPrint) \
+		gen(StKeySeq) \
+		gen(StKeySkipCsi) \
+		gen(StKeySkipSubNeg) \
 
 #define dGenKeyStateEnum(s) s,
 dProcessStateEnum(KeyState);
@@ -53,21 +42,133 @@ dProcessStateEnum(KeyState);
 dProcessStateStr(KeyState);
 #endif
 
-#define dByteCheckCtrlKeyCommit(b, k)	\
-if (key == b) \
-{ \
-	keyCtrlCommit(k, mModShift, mModAlt, mModCtrl); \
-	mStateKey = StKeyMain; \
-	return Positive; \
-}
+/*
+ * Wildcards usable in key sequences. Explicit bytes
+ * always win over wildcards on the same position
+ */
+#define dSeqMod		"\x01" // '1'..'8' => 1 + (Shift=1 | Alt=2 | Ctrl=4)
+#define dSeqPrint		"\x02" // 0x20..0x7E
+#define dSeqAny		"\x03" // 0x00..0xFF
+
+enum SeqKeyAction
+{
+	SeqIgnore = 0,
+	SeqCtrl,
+	SeqPrintAlt,
+	SeqIacWill,
+	SeqIacWont,
+	SeqIacDo,
+	SeqIacDont,
+};
 
-#define dKeyIgnore(k)	\
-if (key == k) \
-{ \
-	/* procInfLog("ignoring %u, 0x%02X", key, key); */ \
-	mStateKey = StKeyMain; \
-	return Pending; \
-}
+// https://en.wikipedia.org/wiki/ANSI_escape_code#Terminal_input_sequences
+// https://invisible-island.net/xterm/ctlseqs/ctlseqs.html#h2-PC-Style-Function-Keys
+#define dForEach_SeqKey(gen) \
+		gen("\x1b\x1b",			SeqCtrl,	keyEsc,	0) \
+		gen("\x1b" dSeqPrint,		SeqPrintAlt,	0,		0) \
+		\
+		gen("\x1b[A",			SeqCtrl,	keyUp,		0) \
+		gen("\x1b[B",			SeqCtrl,	keyDown,	0) \
+		gen("\x1b[C",			SeqCtrl,	keyRight,	0) \
+		gen("\x1b[D",			SeqCtrl,	keyLeft,	0) \
+		gen("\x1b[F",			SeqCtrl,	keyEnd,	0) \
+		gen("\x1b[H",			SeqCtrl,	keyHome,	0) \
+		gen("\x1b[Z",			SeqCtrl,	keyTab,	dModShift) \
+		gen("\x1b[1;" dSeqMod "A",	SeqCtrl,	keyUp,		0) \
+		gen("\x1b[1;" dSeqMod "B",	SeqCtrl,	keyDown,	0) \
+		gen("\x1b[1;" dSeqMod "C",	SeqCtrl,	keyRight,	0) \
+		gen("\x1b[1;" dSeqMod "D",	SeqCtrl,	keyLeft,	0) \
+		gen("\x1b[1;" dSeqMod "F",	SeqCtrl,	keyEnd,	0) \
+		gen("\x1b[1;" dSeqMod "H",	SeqCtrl,	keyHome,	0) \
+		gen("\x1bOA",			SeqCtrl,	keyUp,		dModCtrl) \
+		gen("\x1bOB",			SeqCtrl,	keyDown,	dModCtrl) \
+		gen("\x1bOC",			SeqCtrl,	keyRight,	dModCtrl) \
+		gen("\x1bOD",			SeqCtrl,	keyLeft,	dModCtrl) \
+		\
+		gen("\x1b[1~",			SeqCtrl,	keyHome,	0) \
+		gen("\x1b[2~",			SeqCtrl,	keyInsert,	0) \
+		gen("\x1b[3~",			SeqCtrl,	keyDelete,	0) \
+		gen("\x1b[4~",			SeqCtrl,	keyEnd,	0) \
+		gen("\x1b[5~",			SeqCtrl,	keyPgUp,	0) \
+		gen("\x1b[6~",			SeqCtrl,	keyPgDn,	0) \
+		gen("\x1b[7~",			SeqCtrl,	keyHome,	0) \
+		gen("\x1b[8~",			SeqCtrl,	keyEnd,	0) \
+		gen("\x1b[2;" dSeqMod "~",	SeqCtrl,	keyInsert,	0) \
+		gen("\x1b[3;" dSeqMod "~",	SeqCtrl,	keyDelete,	0) \
+		gen("\x1b[5;" dSeqMod "~",	SeqCtrl,	keyPgUp,	0) \
+		gen("\x1b[6;" dSeqMod "~",	SeqCtrl,	keyPgDn,	0) \
+		\
+		gen("\x1bOP",			SeqCtrl,	keyF1,		0) \
+		gen("\x1bOQ",			SeqCtrl,	keyF2,		0) \
+		gen("\x1bOR",			SeqCtrl,	keyF3,		0) \
+		gen("\x1bOS",			SeqCtrl,	keyF4,		0) \
+		gen("\x1b[1;" dSeqMod "P",	SeqCtrl,	keyF1,		0) \
+		gen("\x1b[1;" dSeqMod "Q",	SeqCtrl,	keyF2,		0) \
+		gen("\x1b[1;" dSeqMod "R",	SeqCtrl,	keyF3,		0) \
+		gen("\x1b[1;" dSeqMod "S",	SeqCtrl,	keyF4,		0) \
+		gen("\x1b[10~",			SeqCtrl,	keyF0,		0) \
+		gen("\x1b[11~",			SeqCtrl,	keyF1,		0) \
+		gen("\x1b[12~",			SeqCtrl,	keyF2,		0) \
+		gen("\x1b[13~",			SeqCtrl,	keyF3,		0) \
+		gen("\x1b[14~",			SeqCtrl,	keyF4,		0) \
+		gen("\x1b[15~",			SeqCtrl,	keyF5,		0) \
+		gen("\x1b[17~",			SeqCtrl,	keyF6,		0) \
+		gen("\x1b[18~",			SeqCtrl,	keyF7,		0) \
+		gen("\x1b[19~",			SeqCtrl,	keyF8,		0) \
+		gen("\x1b[20~",			SeqCtrl,	keyF9,		0) \
+		gen("\x1b[21~",			SeqCtrl,	keyF10,	0) \
+		gen("\x1b[23~",			SeqCtrl,	keyF11,	0) \
+		gen("\x1b[24~",			SeqCtrl,	keyF12,	0) \
+		gen("\x1b[25~",			SeqCtrl,	keyF13,	0) \
+		gen("\x1b[26~",			SeqCtrl,	keyF14,	0) \
+		gen("\x1b[28~",			SeqCtrl,	keyF15,	0) \
+		gen("\x1b[29~",			SeqCtrl,	keyF16,	0) \
+		gen("\x1b[31~",			SeqCtrl,	keyF17,	0) \
+		gen("\x1b[32~",			SeqCtrl,	keyF18,	0) \
+		gen("\x1b[33~",			SeqCtrl,	keyF19,	0) \
+		gen("\x1b[34~",			SeqCtrl,	keyF20,	0) \
+		\
+		gen("\xff\xfb" dSeqAny,		SeqIacWill,	0,		0) \
+		gen("\xff\xfc" dSeqAny,		SeqIacWont,	0,		0) \
+		gen("\xff\xfd" dSeqAny,		SeqIacDo,	0,		0) \
+		gen("\xff\xfe" dSeqAny,		SeqIacDont,	0,		0) \
+		gen("\xff\xf1",			SeqIgnore,	0,		0) /* NOP */ \
+		gen("\xff\xf4",			SeqIgnore,	0,		0) /* IP */ \
+
+struct SeqKey
+{
+	const char *pSeq;
+	uint8_t action;
+	CtrlKeyUser key;
+	uint8_t mod;
+};
+
+#define dModShift		1
+#define dModAlt		2
+#define dModCtrl		4
+
+#define dGenSeqKey(seq, act, key, mod) { seq, act, key, mod },
+static const SeqKey seqsKey[] =
+{
+	dForEach_SeqKey(dGenSeqKey)
+};
+
+static const size_t cNumSeqsKey = sizeof(seqsKey) / sizeof(seqsKey[0]);
+
+/*
+ * Table entry
+ * - 0:                    No transition. Sequence unknown
+ * - cFlagSeqEnd | idx:    Sequence seqsKey[idx] complete
+ * - cFlagSeqMod | node:   Modifier digit, continue with node
+ * - node:                 Continue with node
+ */
+const uint16_t cFlagSeqEnd = 0x8000;
+const uint16_t cFlagSeqMod = 0x4000;
+const uint16_t cMaskSeq = 0x3FFF;
+const size_t cNumNodesSeqMax = 128;
+
+static uint16_t tableSeqKey[cNumNodesSeqMax][256];
+static size_t numNodesSeqKey = 0;
 
 // --------------------
 
@@ -87,26 +188,52 @@ dProcessStateStr(ProcState);
 
 using namespace std;
 
+const size_t cSizeOutFlush = 4096;
+
+// Pasted scripts are handled in one tick
+const size_t cSizeBufRead = 2048;
+
 // http://www.iana.org/assignments/telnet-options/telnet-options.xhtml#telnet-options-1
 #define keyIacWill		0xFB // RFC854
 #define keyIacWont		0xFC // RFC854
 #define keyIacDo		0xFD // RFC854
 #define keyIacDont		0xFE // RFC854
 #define keyIac			0xFF // RFC854
+#define keySubNeg		0xFA // RFC854
+#define keySubNegEnd	0xF0 // RFC854
 #define keyEcho		0x01 // RFC857
 #define keySuppGoAhd	0x03 // RFC858
 #define keyStatus		0x05 // RFC859
 #define keyLineMode		0x22 // RFC1184
 #define keyEncrypt		0x26 // RFC2946
+#define keyCompress2	0x56 // MCCP2
+
+#if CONFIG_APP_HAVE_ZLIB
+const size_t cSizeBufZ = 4096;
+#endif
 
 TelnetFiltering::TelnetFiltering(int fd)
 	: KeyFiltering("TelnetFiltering")
 	, mStateKey(StKeyMain)
-	, mStateKeyRet(StKeyMain)
+	, mNodeSeq(0)
+	, mModSeq(0)
+	, mBytesSeq()
+	, mLenSeq(0)
+	, mIacSkip(false)
 	, mSocketFd(fd)
 	, mpConn(NULL)
 #if CONFIG_PROC_HAVE_DRIVERS
 	, mMtxConn()
+#endif
+	, mBufOut()
+	, mCntSends(0)
+	, mCntFlushes(0)
+#if CONFIG_APP_HAVE_ZLIB
+	, mStreamZ()
+	, mCompressReq(false)
+	, mCompressing(false)
+	, mBytesRaw(0)
+	, mBytesZ(0)
 #endif
 	, mTitle("")
 	, mFragmentUtf("")
@@ -115,9 +242,20 @@ TelnetFiltering::TelnetFiltering(int fd)
 	, mModAlt(false)
 	, mModCtrl(false)
 	, mNumCommited(0)
+	, mNumFastPath(0)
+	, mNumSeqDropped(0)
+	, mRcvdMs(0)
 	, mLast()
+#if CONFIG_APP_HAVE_PROFILING
+	, mProfTick()
+#endif
+#if CONFIG_APP_HAVE_ALLOC_TRACKING
+	, mAllocTick()
+#endif
 {
 	mState = StStart;
+
+	seqTableBuild();
 }
 
 /* member functions */
@@ -129,6 +267,8 @@ void TelnetFiltering::titleSet(const string &title)
 
 Success TelnetFiltering::process()
 {
+	dProfileTick(mProfTick);
+	dAllocTick(mAllocTick);
 	Success success;
 	string msg = "";
 #if 0
@@ -162,6 +302,10 @@ Success TelnetFiltering::process()
 
 		// IAC WONT LINEMODE
 		msg += "\xFF\xFC\x22";
+#if CONFIG_APP_HAVE_ZLIB
+		// IAC WILL COMPRESS2
+		msg += "\xFF\xFB\x56";
+#endif
 #if 0
 		// Deactivate Application Cursor Mode
 		msg += "\033[?1l";
@@ -209,11 +353,17 @@ Success TelnetFiltering::process()
 		break;
 	}
 
-	if (!msg.size())
-		return Pending;
-
-	mpConn->send(msg.c_str(), msg.size());
+#if CONFIG_PROC_HAVE_DRIVERS
+	Guard lock(mMtxConn);
+#endif
+	if (msg.size())
+		mBufOut.insert(0, msg);
 
+	outFlush();
+#if CONFIG_APP_HAVE_ZLIB
+	if (mCompressReq)
+		compressStart();
+#endif
 	return Pending;
 }
 
@@ -225,15 +375,22 @@ Success TelnetFiltering::shutdown()
 	if (!mpConn)
 		return Positive;
 
-	string msg;
-
 	// Show cursor
-	msg += "\033[?25h";
+	mBufOut += "\033[?25h";
 
 	// Restore screen buffer
-	msg += "\033[?1049l";
+	mBufOut += "\033[?1049l";
 
-	mpConn->send(msg.c_str(), msg.size());
+	outFlush();
+#if CONFIG_APP_HAVE_ZLIB
+	if (mCompressing)
+	{
+		// Client resumes plain telnet after end of stream
+		compressedSend(NULL, 0, Z_FINISH);
+		deflateEnd(&mStreamZ);
+		mCompressing = false;
+	}
+#endif
 	mpConn->doneSet();
 	mpConn = NULL;
 
@@ -262,14 +419,110 @@ ssize_t TelnetFiltering::send(const void *pData, size_t len)
 	if (!mSendReady)
 		return procErrLog(-1, "unable to send data. Not ready");
 
-	return mpConn->send(pData, len);
+	mBufOut.append((const char *)pData, len);
+	++mCntSends;
+
+	if (mBufOut.size() >= cSizeOutFlush)
+		outFlush();
+
+	return len;
+}
+
+void TelnetFiltering::flush()
+{
+#if CONFIG_PROC_HAVE_DRIVERS
+	Guard lock(mMtxConn);
+#endif
+	outFlush();
+}
+
+// Lock must be held by caller
+void TelnetFiltering::outFlush()
+{
+	if (!mpConn || !mBufOut.size())
+		return;
+
+#if CONFIG_APP_HAVE_ZLIB
+	if (mCompressing)
+		compressedSend(mBufOut.data(), mBufOut.size(), Z_SYNC_FLUSH);
+	else
+#endif
+	mpConn->send(mBufOut.data(), mBufOut.size());
+	mBufOut.clear();
+
+	++mCntFlushes;
+}
+
+#if CONFIG_APP_HAVE_ZLIB
+/*
+ * MCCP2: Everything after IAC SB COMPRESS2 IAC SE
+ * is one zlib stream. Lock must be held by caller
+ *
+ * Literature
+ * - https://tintin.mudhalla.net/protocols/mccp/
+ */
+void TelnetFiltering::compressStart()
+{
+	int res;
+
+	mCompressReq = false;
+
+	if (mCompressing || !mpConn)
+		return;
+
+	res = deflateInit(&mStreamZ, Z_DEFAULT_COMPRESSION);
+	if (res != Z_OK)
+	{
+		procWrnLog("could not initialize compression: %d", res);
+		return;
+	}
+
+	// IAC SB COMPRESS2 IAC SE
+	mpConn->send("\xFF\xFA\x56\xFF\xF0", 5);
+
+	mCompressing = true;
 }
 
+// Lock must be held by caller
+void TelnetFiltering::compressedSend(const char *pData, size_t len, int flush)
+{
+	char buf[cSizeBufZ];
+	size_t lenOut;
+	int res;
+
+	mStreamZ.next_in = (const Bytef *)pData;
+	mStreamZ.avail_in = (uInt)len;
+
+	mBytesRaw += len;
+
+	do
+	{
+		mStreamZ.next_out = (Bytef *)buf;
+		mStreamZ.avail_out = sizeof(buf);
+
+		res = deflate(&mStreamZ, flush);
+		if (res == Z_STREAM_ERROR)
+		{
+			procWrnLog("could not compress data");
+			return;
+		}
+
+		lenOut = sizeof(buf) - mStreamZ.avail_out;
+		if (!lenOut)
+			continue;
+
+		mpConn->send(buf, lenOut);
+		mBytesZ += lenOut;
+	} while (!mStreamZ.avail_out);
+}
+#endif
+
 Success TelnetFiltering::dataProcess()
 {
 	ssize_t numBytesRead;
-	char buf[8];
+	char buf[cSizeBufRead];
 	const char *pKey;
+	size_t lenRun;
 	Success success;
 
 	numBytesRead = mpConn->read(buf, sizeof(buf) - 1);
@@ -278,6 +531,9 @@ Success TelnetFiltering::dataProcess()
 
 	buf[numBytesRead] = 0;
 	pKey = buf;
+
+	// All keys of one read share the timestamp
+	mRcvdMs = millis();
 #if 0
 	procWrnLog("data received. len = %d", numBytesRead);
 	hexDump(buf, numBytesRead);
@@ -296,6 +552,17 @@ Success TelnetFiltering::dataProcess()
 
 	for (ssize_t i = 0; i < numBytesRead; ++i, ++pKey)
 	{
+		if (mStateKey == StKeyMain)
+		{
+			lenRun = printRunCommit(pKey, numBytesRead - i);
+			if (lenRun)
+			{
+				i += lenRun - 1;
+				pKey += lenRun - 1;
+				continue;
+			}
+		}
+
 		success = keyGet(*pKey);
 		if (success == Pending)
 			continue;
@@ -310,7 +577,39 @@ Success TelnetFiltering::dataProcess()
 	return Positive;;
 }
 
-// https://en.wikipedia.org/wiki/ANSI_escape_code#Terminal_input_sequences
+/*
+ * Fast path for runs of plain printable ASCII in
+ * StKeyMain. Escape, IAC, control and UTF-8 bytes
+ * end the run and go through keyGet()
+ */
+size_t TelnetFiltering::printRunCommit(const char *pData, size_t len)
+{
+	size_t lenRun = 0;
+	uint8_t key;
+
+	for (; lenRun < len; ++lenRun)
+	{
+		key = (uint8_t)pData[lenRun];
+
+		if (key < 0x20 || key > 0x7E)
+			break;
+	}
+
+	if (!lenRun)
+		return 0;
+
+	mModShift = false;
+	mModAlt = false;
+	mModCtrl = false;
+
+	for (size_t i = 0; i < lenRun; ++i)
+		keyPrintCommit((uint8_t)pData[i]);
+
+	mNumFastPath += lenRun;
+
+	return lenRun;
+}
+
 Success TelnetFiltering::keyGet(uint8_t key)
 {
 #if 0
@@ -327,17 +626,14 @@ Success TelnetFiltering::keyGet(uint8_t key)
 		mModAlt = false;
 		mModCtrl = false;
 
-		if (key == keyIac)
+		if (key == keyIac || key == keyEsc)
 		{
-			//procWrnLog("Telnet command received");
-			mStateKey = StKeyIac;
-			break;
-		}
+			mNodeSeq = 0;
+			mModSeq = 0;
+			mLenSeq = 0;
 
-		if (key == keyEsc)
-		{
-			mStateKey = StKeyEscMain;
-			break;
+			mStateKey = StKeySeq;
+			return seqByteProcess(key);
 		}
 
 		if (key == keyCtrlD)
@@ -401,290 +697,148 @@ Success TelnetFiltering::keyGet(uint8_t key)
 		mStateKey = StKeyMain;
 
 		break;
-	case StKeyEscMain:
-
-		if (key == keyEsc)
-		{
-			keyCtrlCommit(keyEsc);
-			return Positive;
-		}
+	case StKeySeq:
 
-		if (key == '[')
-		{
-			mStateKey = StKeyEscBracket;
-			break;
-		}
-
-		if (key == 'O')
-		{
-			mStateKey = StKeyEscO;
-			break;
-		}
-
-		if (isprint(key))
-		{
-			keyPrintCommit(key, false, true);
-			mStateKey = StKeyMain;
-			return Positive;
-		}
-
-		return procErrLog(-1, "unexpected key 0x%02X '%c' in state %s",
-							key, key, KeyStateString[mStateKey]);
+		return seqByteProcess(key);
 
 		break;
-	case StKeyEscO:
-
-		if (key >= 'A' && key <= 'D')
-		{
-			mModCtrl = true;
+	case StKeySkipCsi:
 
-			dByteCheckCtrlKeyCommit('A', keyUp);
-			dByteCheckCtrlKeyCommit('B', keyDown);
-			dByteCheckCtrlKeyCommit('C', keyRight);
-			dByteCheckCtrlKeyCommit('D', keyLeft);
-		}
+		// Final byte of a CSI sequence
+		if (key >= 0x40 && key <= 0x7E)
+			mStateKey = StKeyMain;
 
 		break;
-	case StKeyEscBracket:
-
-		dByteCheckCtrlKeyCommit('A', keyUp);
-		dByteCheckCtrlKeyCommit('B', keyDown);
-		dByteCheckCtrlKeyCommit('C', keyRight);
-		dByteCheckCtrlKeyCommit('D', keyLeft);
-
-		dByteCheckCtrlKeyCommit('F', keyEnd);
-		dByteCheckCtrlKeyCommit('H', keyHome);
+	case StKeySkipSubNeg:
 
-		dByteCheckCtrlKeyCommit('Z', keyTab);
-
-		if (key == '1')
-		{
-			mStateKey = StKeyEsc1;
-			break;
-		}
-
-		if (key == '2')
-		{
-			mStateKey = StKeyEsc2;
-			break;
-		}
-
-		if (key == '3')
-		{
-			mStateKey = StKeyEsc3;
-			break;
-		}
-
-		if (key == '4' || key == '8')
-		{
-			keyCtrlCommit(keyEnd);
-			mStateKey = StKeyEscTilde;
-			break;
-		}
-
-		if (key == '5')
+		if (mIacSkip && key == keySubNegEnd)
 		{
-			keyCtrlCommit(keyPgUp);
-			mStateKey = StKeyEscTilde;
-			break;
-		}
-
-		if (key == '6')
-		{
-			keyCtrlCommit(keyPgDn);
-			mStateKey = StKeyEscTilde;
-			break;
-		}
-
-		if (key == '7')
-		{
-			keyCtrlCommit(keyHome);
-			mStateKey = StKeyEscTilde;
+			mStateKey = StKeyMain;
 			break;
 		}
 
-		return procErrLog(-1, "unexpected key 0x%02X '%c' in state %s",
-							key, key, KeyStateString[mStateKey]);
+		// IAC IAC is a data byte
+		mIacSkip = !mIacSkip && key == keyIac;
 
 		break;
-	case StKeyEsc1:
-
-		dByteCheckCtrlKeyCommit('~', keyHome);
-
-		if (key == ';')
-		{
-			statesKeySet(StKeyMod, StKeyEscBracket);
-			break;
-		}
-
-		if (key >= '0' && key <= '5')
-		{
-			keyCtrlCommit(keyF0 + key);
-			mStateKey = StKeyEscTilde;
-			break;
-		}
-
-		if (key >= '7' && key <= '9')
-		{
-			keyCtrlCommit(keyF6 + (key - 7));
-			mStateKey = StKeyEscTilde;
-			break;
-		}
+	default:
+		break;
+	}
 
-		if (key >= 'P' && key <= 'S')
-		{
-			keyCtrlCommit(keyF1 + (key - 'P'));
-			mStateKey = StKeyMain;
-			return Positive;
-		}
+	return Pending;
+}
 
-		return procErrLog(-1, "unexpected key 0x%02X '%c' in state %s",
-							key, key, KeyStateString[mStateKey]);
+// One table lookup per byte
+Success TelnetFiltering::seqByteProcess(uint8_t key)
+{
+	uint16_t entry = tableSeqKey[mNodeSeq][key];
 
-		break;
-	case StKeyMod:
+	if (!entry)
+	{
+		procWrnLog("unknown sequence. Dropping key 0x%02X", key);
+		++mNumSeqDropped;
 
-		key -= '1';
+		seqSkipStart(key);
+		return Pending;
+	}
 
-		if (key & 1)
-			mModShift = true;
+	if (mLenSeq < sizeof(mBytesSeq))
+		mBytesSeq[mLenSeq] = key;
+	++mLenSeq;
 
-		if (key & 2)
-			mModAlt = true;
+	if (entry & cFlagSeqMod)
+		mModSeq |= key - '1';
 
-		if (key & 4)
-			mModCtrl = true;
+	if (!(entry & cFlagSeqEnd))
+	{
+		mNodeSeq = entry & cMaskSeq;
+		return Pending;
+	}
 
-		mStateKey = mStateKeyRet;
+	mStateKey = StKeyMain;
 
-		break;
-	case StKeyEsc2:
+	const SeqKey &seq = seqsKey[entry & cMaskSeq];
+	uint8_t mod = mModSeq | seq.mod;
 
-		dByteCheckCtrlKeyCommit('~', keyInsert);
+	mModShift = mod & dModShift;
+	mModAlt = mod & dModAlt;
+	mModCtrl = mod & dModCtrl;
 
-		if (key == ';')
-		{
-			statesKeySet(StKeyMod, StKeyEsc2);
-			break;
-		}
+	switch (seq.action)
+	{
+	case SeqCtrl:
+		keyCtrlCommit(seq.key, mModShift, mModAlt, mModCtrl);
+		return Positive;
+	case SeqPrintAlt:
+		keyPrintCommit(key, false, true);
+		return Positive;
+	case SeqIacWill:
 
-		if (key >= '0' && key <= '1')
-		{
-			keyCtrlCommit(keyF9 + key);
-			mStateKey = StKeyEscTilde;
+		if (key == keyEncrypt)
 			break;
-		}
 
-		if (key >= '3' && key <= '6')
-		{
-			keyCtrlCommit(keyF11 + (key - 3));
-			mStateKey = StKeyEscTilde;
-			break;
-		}
+		procWrnLog("unknown WILL option: 0x%02X", key);
+		break;
+	case SeqIacWont:
 
-		if (key >= '8' && key <= '9')
-		{
-			keyCtrlCommit(keyF15 + (key - 8));
-			mStateKey = StKeyEscTilde;
+		if (key == keyLineMode)
 			break;
-		}
-
-		return procErrLog(-1, "unexpected key 0x%02X '%c' in state %s",
-							key, key, KeyStateString[mStateKey]);
 
+		procWrnLog("unknown WONT option: 0x%02X", key);
 		break;
-	case StKeyEsc3:
-
-		dByteCheckCtrlKeyCommit('~', keyDelete);
+	case SeqIacDo:
 
-		if (key == ';')
-		{
-			statesKeySet(StKeyMod, StKeyEsc3);
+		if (key == keyEcho || key == keySuppGoAhd || key == keyStatus)
 			break;
-		}
-
-		if (key >= '1' && key <= '4')
+#if CONFIG_APP_HAVE_ZLIB
+		if (key == keyCompress2)
 		{
-			keyCtrlCommit(keyF17 + (key - 1));
-			mStateKey = StKeyEscTilde;
+			// Started at the end of the tick under the lock
+			mCompressReq = true;
 			break;
 		}
+#endif
 
-		return procErrLog(-1, "unexpected key 0x%02X '%c' in state %s",
-							key, key, KeyStateString[mStateKey]);
-
-		break;
-	case StKeyEscTilde:
-
-		if (key == '~')
-		{
-			mStateKey = StKeyMain;
-			return Positive;
-		}
-
-		return procErrLog(-1, "unexpected key 0x%02X '%c' in state %s",
-							key, key, KeyStateString[mStateKey]);
-
-		break;
-	case StKeyIac:
-
-		if (key == keyIacWill)
-			mStateKey = StKeyIacWill;
-		else
-		if (key == keyIacWont)
-			mStateKey = StKeyIacWont;
-		else
-		if (key == keyIacDo)
-			mStateKey = StKeyIacDo;
-		else
-		if (key == keyIacDont)
-			mStateKey = StKeyIacDont;
-		else
-			return procErrLog(-1, "unsupported IAC: 0x%02X", key);
-
+		procWrnLog("unknown DO option: 0x%02X", key);
 		break;
-	case StKeyIacWill:
+	case SeqIacDont:
 
-		dKeyIgnore(keyEncrypt);
-
-		procWrnLog("unknown WILL option: 0x%02X", key);
-		mStateKey = StKeyMain;
+		// Client declined. Output stays plain
+		if (key == keyCompress2)
+			break;
 
+		procWrnLog("unknown DONT option: 0x%02X", key);
 		break;
-	case StKeyIacWont:
-
-		dKeyIgnore(keyLineMode);
-
-		procWrnLog("unknown WONT option: 0x%02X", key);
-		mStateKey = StKeyMain;
-
+	default:
 		break;
-	case StKeyIacDo:
-
-		dKeyIgnore(keyEcho);
-		dKeyIgnore(keySuppGoAhd);
-		dKeyIgnore(keyStatus);
-
-		procWrnLog("unknown DO option: 0x%02X", key);
-		mStateKey = StKeyMain;
+	}
 
-		break;
-	case StKeyIacDont:
+	return Pending;
+}
 
-		procWrnLog("unknown DONT option: 0x%02X", key);
-		mStateKey = StKeyMain;
+/*
+ * The remainder of an unknown sequence must not reach
+ * the command line as printable keys
+ * - ESC [ ...:  Skip until the final byte
+ * - IAC SB ...: Skip until IAC SE
+ */
+void TelnetFiltering::seqSkipStart(uint8_t key)
+{
+	bool isCsi = mLenSeq >= 2 &&
+			mBytesSeq[0] == keyEsc && mBytesSeq[1] == '[';
+	bool isSubNeg = mLenSeq == 1 &&
+			mBytesSeq[0] == keyIac && key == keySubNeg;
 
-		break;
-	case StKeyPrint:
+	mStateKey = StKeyMain;
 
-		procWrnLog("got key 0x%02X '%c'", key, key);
+	if (isCsi && (key < 0x40 || key > 0x7E))
+		mStateKey = StKeySkipCsi;
 
-		break;
-	default:
-		break;
+	if (isSubNeg)
+	{
+		mIacSkip = false;
+		mStateKey = StKeySkipSubNeg;
 	}
-
-	return Pending;
 }
 
 void TelnetFiltering::keyPrintCommit(char32_t key, bool modShift, bool modAlt, bool modCtrl)
@@ -697,7 +851,7 @@ void TelnetFiltering::keyPrintCommit(char32_t key, bool modShift, bool modAlt, b
 	cKey.modAltSet(modAlt);
 	cKey.modCtrlSet(modCtrl);
 
-	ppKeys.commit(cKey, millis());
+	ppKeys.commit(cKey, mRcvdMs);
 
 	++mNumCommited;
 	mLast = cKey;
@@ -713,18 +867,12 @@ void TelnetFiltering::keyCtrlCommit(CtrlKeyUser key, bool modShift, bool modAlt,
 	cKey.modAltSet(modAlt);
 	cKey.modCtrlSet(modCtrl);
 
-	ppKeys.commit(cKey, millis());
+	ppKeys.commit(cKey, mRcvdMs);
 
 	++mNumCommited;
 	mLast = cKey;
 }
 
-void TelnetFiltering::statesKeySet(uint32_t state, uint32_t stateRet)
-{
-	mStateKey = state;
-	mStateKeyRet = stateRet;
-}
-
 void TelnetFiltering::processInfo(char *pBuf, char *pBufEnd)
 {
 	(void)pBuf;
@@ -733,9 +881,148 @@ void TelnetFiltering::processInfo(char *pBuf, char *pBufEnd)
 	dInfo("State\t\t\t%s\n", ProcStateString[mState]);
 	dInfo("State Key\t\t%s\n", KeyStateString[mStateKey]);
 	dInfo("Commited\t\t%zu\n", mNumCommited);
+	dInfo("Fast path\t\t%zu\n", mNumFastPath);
+	dInfo("Sequence nodes\t\t%zu\n", numNodesSeqKey);
+	dInfo("Sequences dropped\t%zu\n", mNumSeqDropped);
 	dInfo("Last\t\t\t%s\n", mLast.str().c_str());
 #endif
+	dInfo("Sends / Flushes\t\t%zu / %zu\n", mCntSends, mCntFlushes);
+#if CONFIG_APP_HAVE_ZLIB
+	dInfo("Compression\t\t%s\n", mCompressing ? "MCCP2" : "None");
+	if (mCompressing)
+		dInfo("Raw / Compressed\t%zu / %zu\n", mBytesRaw, mBytesZ);
+#endif
+	dProfileInfo(mProfTick);
+	dAllocInfo(mAllocTick);
 }
 
 /* static functions */
 
+/*
+ * Expands one position of a sequence to the byte
+ * range it covers. Returns the flags of the edge
+ */
+static uint16_t seqRangeGet(uint8_t ch, uint16_t &idxStart, uint16_t &idxEnd)
+{
+	if (ch == dSeqMod[0])
+	{
+		idxStart = '1';
+		idxEnd = '8';
+		return cFlagSeqMod;
+	}
+
+	if (ch == dSeqPrint[0])
+	{
+		idxStart = 0x20;
+		idxEnd = 0x7E;
+		return 0;
+	}
+
+	if (ch == dSeqAny[0])
+	{
+		idxStart = 0x00;
+		idxEnd = 0xFF;
+		return 0;
+	}
+
+	idxStart = ch;
+	idxEnd = ch;
+	return 0;
+}
+
+static bool seqIsWild(const char *pSeq)
+{
+	for (; *pSeq; ++pSeq)
+	{
+		if (*pSeq == dSeqPrint[0] || *pSeq == dSeqAny[0])
+			return true;
+	}
+
+	return false;
+}
+
+static void seqInsert(size_t idxSeq)
+{
+	const uint8_t *pCh = (const uint8_t *)seqsKey[idxSeq].pSeq;
+	uint16_t node = 0, nodeNext, flags, entry;
+	uint16_t idxStart, idxEnd, idx;
+	bool last;
+
+	for (; *pCh; ++pCh)
+	{
+		flags = seqRangeGet(*pCh, idxStart, idxEnd);
+		last = !pCh[1];
+
+		if (last)
+		{
+			for (idx = idxStart; idx <= idxEnd; ++idx)
+			{
+				if (tableSeqKey[node][idx])
+					continue;
+
+				tableSeqKey[node][idx] = cFlagSeqEnd | flags | idxSeq;
+			}
+
+			return;
+		}
+
+		// Follow an existing inner edge of the range
+		nodeNext = 0;
+		for (idx = idxStart; idx <= idxEnd; ++idx)
+		{
+			entry = tableSeqKey[node][idx];
+			if (!entry || (entry & cFlagSeqEnd))
+				continue;
+
+			nodeNext = entry & cMaskSeq;
+			break;
+		}
+
+		if (!nodeNext)
+		{
+			if (numNodesSeqKey >= cNumNodesSeqMax)
+			{
+				errLog(-1, "too many nodes for key sequences");
+				return;
+			}
+
+			nodeNext = numNodesSeqKey++;
+		}
+
+		for (idx = idxStart; idx <= idxEnd; ++idx)
+		{
+			if (tableSeqKey[node][idx])
+				continue;
+
+			tableSeqKey[node][idx] = flags | nodeNext;
+		}
+
+		node = nodeNext;
+	}
+}
+
+/*
+ * Generates the decoding table from seqsKey[].
+ * Wildcard sequences go last so they only fill
+ * the gaps left by the explicit ones
+ */
+void TelnetFiltering::seqTableBuild()
+{
+	if (numNodesSeqKey)
+		return;
+
+	numNodesSeqKey = 1; // root
+
+	for (size_t i = 0; i < cNumSeqsKey; ++i)
+	{
+		if (!seqIsWild(seqsKey[i].pSeq))
+			seqInsert(i);
+	}
+
+	for (size_t i = 0; i < cNumSeqsKey; ++i)
+	{
+		if (seqIsWild(seqsKey[i].pSeq))
+			seqInsert(i);
+	}
+}
+
@@ -27,9 +27,20 @@
 #define TELNET_FILTERING_H
 
 #include "Processing.h"
+#include "LibProfiling.h"
+#include "LibAllocTracking.h"
 #include "KeyFiltering.h"
 #include "TcpTransfering.h"
 
+#ifndef CONFIG_APP_HAVE_ZLIB
+#define CONFIG_APP_HAVE_ZLIB			0
+#endif
+
+#if CONFIG_APP_HAVE_ZLIB
+#define ZLIB_CONST
+#include <zlib.h>
+#endif
+
 class TelnetFiltering : public KeyFiltering
 {
 
@@ -43,7 +54,13 @@ public:
 	void titleSet(const std::string &title);
 
 	ssize_t read(void *pBuf, size_t len);
+	/*
+	 * Output is gathered during one tick and flushed
+	 * at the end of it. Large outputs are flushed as
+	 * soon as they reach cSizeOutFlush
+	 */
 	ssize_t send(const void *pData, size_t len);
+	void flush();
 
 protected:
 
@@ -65,7 +82,13 @@ private:
 	Success shutdown();
 	void processInfo(char *pBuf, char *pBufEnd);
 
+	void outFlush();
+#if CONFIG_APP_HAVE_ZLIB
+	void compressStart();
+	void compressedSend(const char *pData, size_t len, int flush);
+#endif
 	Success dataProcess();
+	size_t printRunCommit(const char *pData, size_t len);
 	Success keyGet(uint8_t key);
 	void keyPrintCommit(char32_t key,
 				bool modShift = false,
@@ -75,15 +98,30 @@ private:
 				bool modShift = false,
 				bool modAlt = false,
 				bool modCtrl = false);
-	void statesKeySet(uint32_t state, uint32_t stateRet);
+	Success seqByteProcess(uint8_t key);
+	void seqSkipStart(uint8_t key);
 
 	/* member variables */
 	uint32_t mStateKey;
-	uint32_t mStateKeyRet;
+	uint16_t mNodeSeq;
+	uint8_t mModSeq;
+	uint8_t mBytesSeq[2];
+	uint8_t mLenSeq;
+	bool mIacSkip;
 	int mSocketFd;
 	TcpTransfering *mpConn;
 #if CONFIG_PROC_HAVE_DRIVERS
 	std::mutex mMtxConn;
+#endif
+	std::string mBufOut;
+	size_t mCntSends;
+	size_t mCntFlushes;
+#if CONFIG_APP_HAVE_ZLIB
+	z_stream mStreamZ;
+	bool mCompressReq;
+	bool mCompressing;
+	size_t mBytesRaw;
+	size_t mBytesZ;
 #endif
 	std::string mTitle;
 	std::string mFragmentUtf;
@@ -92,9 +130,19 @@ private:
 	bool mModAlt;
 	bool mModCtrl;
 	size_t mNumCommited;
+	size_t mNumFastPath;
+	size_t mNumSeqDropped;
+	uint32_t mRcvdMs;
 	KeyUser mLast;
 
+#if CONFIG_APP_HAVE_PROFILING
+	ProfileTick mProfTick;
+#endif
+#if CONFIG_APP_HAVE_ALLOC_TRACKING
+	AllocStats mAllocTick;
+#endif
 	/* static functions */
+	static void seqTableBuild();
 
 	/* static variables */
 
@@ -14,6 +14,7 @@
 #define ENV_H
 
 #include <string>
+#include <vector>
 
 /*
  * ##################################
@@ -31,13 +32,21 @@ struct Environment
 #endif
 	uint8_t ctrlManual;
 	std::string codeUart;
-	std::string deviceUart;
+	std::vector<std::string> devicesUart;
 	uint32_t rateRefreshMs;
 	uint16_t startPortsOrb;
 	uint16_t startPortsTarget;
+	uint16_t portMetrics;
+	std::string dirHistory;
+	bool uartTap;
+	bool logTiming;
 };
 
 extern Environment env;
 
+// Each target gets its own port block starting at
+// startPortsTarget + index * cNumPortsPerTarget
+const uint16_t cNumPortsPerTarget = 10;
+
 #endif
 
@@ -46,6 +46,7 @@
 #endif
 #include "GwSupervising.h"
 #include "LibDspc.h"
+#include "LibWakeup.h"
 
 #include "env.h"
 
@@ -71,6 +72,13 @@ const int cRateRefreshMaxMs = 20000;
 #define dStartPortsTargetDefault "3000"
 const int cPortMax = 64000;
 
+/*
+ * Upper bound for sleeping in the main loop. Needed
+ * because the TCP listeners and transfers can't report
+ * their sockets. Same as the former fixed tick
+ */
+const uint32_t cWaitMaxMs = 15;
+
 Environment env;
 GwSupervising *pApp = NULL;
 
@@ -100,6 +108,7 @@ void applicationCloseRequest(int signum)
 	(void)signum;
 	cout << endl;
 	pApp->unusedSet();
+	wakeupNotify();
 }
 
 #if defined(_WIN32)
@@ -125,7 +134,7 @@ void helpPrint()
 	cout << "Version: " << dVersion << endl;
 
 	cout << endl;
-	cout << "Usage: " << dAppName << " [code] [device]" << endl;
+	cout << "Usage: " << dAppName << " [code] [device]..." << endl;
 	cout << endl;
 }
 #endif
@@ -139,11 +148,15 @@ int main(int argc, char *argv[])
 #endif
 	env.ctrlManual = 0;
 	env.codeUart = dCodeUartDefault;
-	env.deviceUart = dDeviceUartDefault;
+	env.devicesUart.clear();
 	env.rateRefreshMs = cRateRefreshDefaultMs;
 
 	env.startPortsOrb = stoi(dStartPortsOrbDefault);
 	env.startPortsTarget = stoi(dStartPortsTargetDefault);
+	env.portMetrics = 0;
+	env.dirHistory = "";
+	env.uartTap = false;
+	env.logTiming = false;
 
 #if APP_HAS_TCLAP
 	int res;
@@ -170,8 +183,9 @@ int main(int argc, char *argv[])
 	ValueArg<string> argCodeUart("c", "code", "Code used for UART initialization. Default: " dCodeUartDefault,
 								false, env.codeUart, "string");
 	cmd.add(argCodeUart);
-	ValueArg<string> argDevUart("d", "device", "Device used for UART communication. Default: " dDeviceUartDefault,
-								false, env.deviceUart, "string");
+	MultiArg<string> argDevUart("d", "device", "Device used for UART communication. "
+								"Repeat for multiple targets. Default: " dDeviceUartDefault,
+								false, "string");
 	cmd.add(argDevUart);
 	ValueArg<int> argRateRefreshMs("", "refresh-rate", "Refresh rate of process tree in [ms]",
 								false, env.rateRefreshMs, "uint16");
@@ -183,6 +197,16 @@ int main(int argc, char *argv[])
 	ValueArg<int> argStartPortTarget("", "start-ports-target", "Start of 3-port interface for the target. Default: " dStartPortsTargetDefault,
 								false, env.startPortsTarget, "uint16");
 	cmd.add(argStartPortTarget);
+	ValueArg<int> argPortMetrics("", "port-metrics", "Port of Prometheus metrics endpoint. Default: 0 (disabled)",
+								false, env.portMetrics, "uint16");
+	cmd.add(argPortMetrics);
+	ValueArg<string> argDirHistory("", "dir-history", "Directory for process tree history spilled from memory. Default: None",
+								false, env.dirHistory, "string");
+	cmd.add(argDirHistory);
+	SwitchArg argUartTap("", "uart-tap", "Mirror raw UART bytes on the port after the command port", false);
+	cmd.add(argUartTap);
+	SwitchArg argLogTiming("", "log-timing", "Prefix log entries with host time and latencies in [us]", false);
+	cmd.add(argLogTiming);
 
 	cmd.parse(argc, argv);
 
@@ -197,7 +221,7 @@ int main(int argc, char *argv[])
 	env.coreDump = argCoreDump.getValue();
 #endif
 	env.codeUart = argCodeUart.getValue();
-	env.deviceUart = argDevUart.getValue();
+	env.devicesUart = argDevUart.getValue();
 
 	res = argRateRefreshMs.getValue();
 	if (res > cRateRefreshMinMs &&
@@ -211,14 +235,22 @@ int main(int argc, char *argv[])
 	res = argStartPortTarget.getValue();
 	if (res > 0 && res <= cPortMax)
 		env.startPortsTarget = res;
+
+	res = argPortMetrics.getValue();
+	if (res > 0 && res <= cPortMax)
+		env.portMetrics = res;
+
+	env.dirHistory = argDirHistory.getValue();
+	env.uartTap = argUartTap.getValue();
+	env.logTiming = argLogTiming.getValue();
 #else
 	env.haveTclap = 0;
 	env.verbosity = 2;
 
 	if (argc >= 2)
 		env.codeUart = string(argv[1]);
-	if (argc >= 3)
-		env.deviceUart = string(argv[2]);
+	for (int i = 2; i < argc; ++i)
+		env.devicesUart.push_back(string(argv[i]));
 
 	if (env.codeUart == "--help" ||
 			env.codeUart == "-h")
@@ -228,6 +260,15 @@ int main(int argc, char *argv[])
 	}
 #endif
 
+	if (!env.devicesUart.size())
+		env.devicesUart.push_back(dDeviceUartDefault);
+
+	if (env.startPortsTarget + env.devicesUart.size() * cNumPortsPerTarget > cPortMax)
+	{
+		errLog(-1, "too many targets for port range");
+		return 1;
+	}
+
 #if defined(_WIN32)
 	// https://learn.microsoft.com/en-us/windows/console/setconsolectrlhandler
 	BOOL okWin;
@@ -252,12 +293,19 @@ int main(int argc, char *argv[])
 
 	pApp->procTreeDisplaySet(true);
 
+	if (!wakeupInit())
+		wrnLog("could not initialize wakeup handling");
+
 	while (1)
 	{
 		for (int i = 0; i < 3; ++i)
+		{
+			dProfileTick(GwSupervising::profTreeTick);
 			pApp->treeTick();
+		}
 
-		this_thread::sleep_for(chrono::milliseconds(15));
+		// Blocks until the earliest deadline or I/O
+		wakeupWait(cWaitMaxMs);
 
 		if (pApp->progress())
 			continue;
@@ -268,6 +316,8 @@ int main(int argc, char *argv[])
 	Success success = pApp->success();
 	Processing::destroy(pApp);
 
+	wakeupDeInit();
+
 	Processing::applicationClose();
 
 	return !(success == Positive);